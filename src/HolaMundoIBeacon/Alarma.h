@@ -0,0 +1,111 @@
+/**
+ * @file Alarma.h
+ * @brief Evaluación de alarmas por umbral con histéresis.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cada muestra nueva de O3 o CO2 se compara con un umbral de
+ * activación y otro de desactivación (más bajo) para que una medida que
+ * oscila alrededor del límite no dispare la alarma una y otra vez. Cuando
+ * una alarma se activa, el loop() interrumpe el ciclo normal y emite una
+ * ráfaga de anuncios a alta frecuencia con la bandera de alarma.
+ */
+
+#ifndef ALARMA_H_INCLUIDO
+#define ALARMA_H_INCLUIDO
+
+#include <stdint.h>
+
+// ===================== BANDERAS DE ALARMA =====================
+
+const uint8_t ALARMA_O3 = 0x01;  ///< Bit de alarma por ozono.
+const uint8_t ALARMA_CO2 = 0x02; ///< Bit de alarma por CO2.
+
+// ===================== CONSTANTES DE LA RÁFAGA =====================
+
+/// @brief Intervalo de anuncio durante la ráfaga (unidades de 0.625 ms, 20 ms es el mínimo legal).
+const uint16_t INTERVALO_RAFAGA = 32;
+/// @brief Duración de la ráfaga de anuncios de alarma (ms).
+const unsigned long DURACION_RAFAGA_MS = 3000;
+/// @brief Cada cuánto se toma una muestra nueva mientras se espera el siguiente ciclo (ms).
+const unsigned long PERIODO_VIGILANCIA_MS = 1000;
+
+/**
+ * @struct UmbralAlarma
+ * @brief Par de umbrales que define la histéresis de una alarma.
+ */
+struct UmbralAlarma {
+  uint16_t activacion;     ///< La alarma salta al alcanzar este valor.
+  uint16_t desactivacion;  ///< La alarma se apaga al bajar de este valor.
+};
+
+/**
+ * @class EvaluadorAlarmas
+ * @brief Mantiene el estado de las alarmas de O3 y CO2.
+ */
+class EvaluadorAlarmas {
+
+private:
+  UmbralAlarma umbralO3 { 200, 150 };     ///< Umbrales de O3 (ppb).
+  UmbralAlarma umbralCO2 { 2000, 1800 };  ///< Umbrales de CO2 (ppm).
+  uint8_t activas = 0;                    ///< Máscara de alarmas activas.
+
+  /**
+   * @brief Evalúa una magnitud y actualiza su bit en la máscara de activas.
+   * @param valor Muestra nueva.
+   * @param umbral Umbrales de la magnitud.
+   * @param bit Bit de la alarma.
+   * @return bit si la alarma acaba de activarse, 0 en otro caso.
+   */
+  uint8_t evaluarUna( uint16_t valor, const UmbralAlarma & umbral, uint8_t bit ) {
+    if ( ( activas & bit ) == 0 ) {
+      if ( valor >= umbral.activacion ) {
+        activas |= bit;
+        return bit;
+      }
+    } else if ( valor < umbral.desactivacion ) {
+      activas &= (uint8_t) ~bit;
+    }
+    return 0;
+  }
+
+public:
+
+  /**
+   * @brief Constructor por defecto (umbrales de fábrica).
+   */
+  EvaluadorAlarmas( ) {
+  }
+
+  /**
+   * @brief Cambia los umbrales de las alarmas.
+   * @param o3 Umbrales de O3 (ppb).
+   * @param co2 Umbrales de CO2 (ppm).
+   */
+  void configurarUmbrales( const UmbralAlarma & o3, const UmbralAlarma & co2 ) {
+    umbralO3 = o3;
+    umbralCO2 = co2;
+  }
+
+  /**
+   * @brief Evalúa una muestra nueva de O3 y CO2.
+   * @param o3ppb Ozono en ppb.
+   * @param co2ppm CO2 en ppm.
+   * @return Máscara de las alarmas que se acaban de activar (0 si ninguna).
+   */
+  uint8_t evaluar( uint16_t o3ppb, uint16_t co2ppm ) {
+    uint8_t nuevas = evaluarUna( o3ppb, umbralO3, ALARMA_O3 );
+    nuevas |= evaluarUna( co2ppm, umbralCO2, ALARMA_CO2 );
+    return nuevas;
+  }
+
+  /**
+   * @brief Alarmas activas en este momento.
+   * @return Máscara de bits ALARMA_O3 / ALARMA_CO2.
+   */
+  uint8_t getActivas() const {
+    return activas;
+  }
+
+}; // class
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file ColaMedidas.h
+ * @brief Cola de tramas v2 pendientes de enviar por conexión.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cada trama que se anuncia se guarda también aquí hasta que un
+ * central conectado y suscrito la recibe por notificación. Así un central
+ * que se conecta de vez en cuando (p.ej. un móvil) descarga las muestras que
+ * se perdió. Los bytes que quedan en la cola son los datos pendientes que
+ * usa el GestorConexion para pasar al perfil masivo.
+ *
+ * Si la cola se llena se pierde la trama más antigua: lo que importa es
+ * tener las muestras recientes.
+ */
+
+#ifndef COLA_MEDIDAS_H_INCLUIDO
+#define COLA_MEDIDAS_H_INCLUIDO
+
+#include <string.h>
+#include "Trama.h"
+
+/**
+ * @class ColaMedidas
+ * @brief Búfer circular de tramas v2.
+ */
+class ColaMedidas {
+
+public:
+  /// @brief Tramas que caben en la cola (una hora con el periodo de 30 s).
+  static const uint16_t CAPACIDAD = 120;
+
+private:
+  uint8_t tramas[CAPACIDAD][TAM_TRAMA_V2];
+  uint16_t primera = 0;   ///< Posición de la trama más antigua.
+  uint16_t numTramas = 0;
+  uint32_t perdidas = 0;  ///< Tramas descartadas por tener la cola llena.
+
+public:
+
+  /**
+   * @brief Añade una trama al final de la cola.
+   * @param trama TAM_TRAMA_V2 bytes.
+   * @return false si la cola estaba llena y se descartó la más antigua.
+   */
+  bool anyadir( const uint8_t * trama ) {
+    bool cabe = numTramas < CAPACIDAD;
+    if ( ! cabe ) {
+      primera = ( primera + 1 ) % CAPACIDAD;
+      numTramas--;
+      perdidas++;
+    }
+    memcpy( tramas[( primera + numTramas ) % CAPACIDAD], trama, TAM_TRAMA_V2 );
+    numTramas++;
+    return cabe;
+  }
+
+  /**
+   * @brief Trama más antigua (la cola no debe estar vacía).
+   */
+  const uint8_t * getPrimera() const {
+    return tramas[primera];
+  }
+
+  /**
+   * @brief Quita la trama más antigua.
+   */
+  void quitar() {
+    if ( numTramas == 0 ) return;
+    primera = ( primera + 1 ) % CAPACIDAD;
+    numTramas--;
+  }
+
+  bool vacia() const { return numTramas == 0; }
+
+  uint16_t getNumTramas() const { return numTramas; }
+
+  /**
+   * @brief Bytes que esperan a enviarse.
+   */
+  uint32_t getBytes() const { return (uint32_t) numTramas * TAM_TRAMA_V2; }
+
+  /**
+   * @brief Tramas descartadas desde el arranque por tener la cola llena.
+   */
+  uint32_t getPerdidas() const { return perdidas; }
+
+}; // class
+
+#endif
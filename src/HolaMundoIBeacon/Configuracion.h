@@ -0,0 +1,249 @@
+/**
+ * @file Configuracion.h
+ * @brief Ajustes de funcionamiento modificables en caliente por BLE.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details El periodo de muestreo, el número de muestras promediadas, el
+ * intervalo de anuncio y la potencia de emisión dejan de ser literales: un
+ * cliente los escribe en una característica GATT, se validan, se aplican de
+ * golpe al empezar el siguiente ciclo del loop() y se guardan en la flash
+ * interna para sobrevivir a un reinicio.
+ */
+
+#ifndef CONFIGURACION_H_INCLUIDO
+#define CONFIGURACION_H_INCLUIDO
+
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+#include "Alarma.h"
+#include "Sobremuestreo.h"
+
+/**
+ * @struct Ajustes
+ * @brief Valores configurables del sistema.
+ * @details **Formato en la característica (17 bytes, Little Endian):**
+ * | Bytes 0-3 | Byte 4 | Byte 5 | Bytes 6-7 | Byte 8 |
+ * |:---------:|:------:|:------:|:---------:|:------:|
+ * | Periodo (ms) | Muestras O3 | Muestras Bat | Intervalo (x0.625 ms) | TX (dBm) |
+ *
+ * Muestras = 0 (MUESTRAS_AUTOMATICAS) deja que el Medidor las elija según el ruido.
+ *
+ * | Bytes 9-10 | Bytes 11-12 | Bytes 13-14 | Bytes 15-16 |
+ * |:----------:|:-----------:|:-----------:|:-----------:|
+ * | O3 activación (ppb) | O3 desactivación (ppb) | CO2 activación (ppm) | CO2 desactivación (ppm) |
+ */
+struct Ajustes {
+  uint32_t periodoMuestreoMs = 30000; ///< Tiempo que se mantiene cada anuncio (ms).
+  uint8_t muestrasO3 = MUESTRAS_AUTOMATICAS;      ///< Lecturas promediadas por medida de O3 (0 = automático).
+  uint8_t muestrasBateria = MUESTRAS_AUTOMATICAS; ///< Lecturas promediadas por medida de batería (0 = automático).
+  uint16_t intervaloAnuncio = 100;    ///< Intervalo de anuncio (unidades de 0.625 ms).
+  int8_t potenciaTx = 4;              ///< Potencia de emisión (dBm).
+  UmbralAlarma alarmaO3 { 200, 150 };     ///< Umbrales de la alarma de O3 (ppb).
+  UmbralAlarma alarmaCO2 { 2000, 1800 };  ///< Umbrales de la alarma de CO2 (ppm).
+};
+
+/**
+ * @class Configuracion
+ * @brief Guarda los ajustes activos y los pendientes de aplicar.
+ * @details La característica se escribe desde la tarea BLE, mientras que el
+ * loop() lee los ajustes. Por eso lo recibido se deja en un búfer pendiente y
+ * solo se copia a los ajustes activos en aplicarPendientes(), que el loop()
+ * llama al principio de cada ciclo: el resto del ciclo nunca ve unos ajustes
+ * a medio aplicar.
+ */
+class Configuracion {
+
+public:
+  /// @brief Tamaño de los ajustes serializados (bytes).
+  static const uint8_t TAM_AJUSTES = 17;
+
+private:
+  /// @brief Fichero de la flash interna donde se guardan los ajustes.
+  static constexpr const char * FICHERO = "/ajustes.bin";
+  /// @brief Fichero donde se escriben antes de sustituir a FICHERO.
+  static constexpr const char * FICHERO_TEMPORAL = "/ajustes.tmp";
+  /// @brief Cabecera del fichero (identifica formato y versión).
+  static const uint8_t MARCA_FICHERO = 0xC2;
+
+  Ajustes activos;               ///< Ajustes que usa el ciclo en curso.
+  Ajustes pendientes;            ///< Últimos ajustes recibidos y validados.
+  volatile bool hayPendientes = false;
+
+  static void escribirU16( uint8_t * p, uint16_t v ) {
+    p[0] = (uint8_t)( v & 0xFF );
+    p[1] = (uint8_t)( v >> 8 );
+  }
+  static uint16_t leerU16( const uint8_t * p ) {
+    return (uint16_t)( p[0] | ( p[1] << 8 ) );
+  }
+
+public:
+
+  /**
+   * @brief Constructor por defecto (ajustes de fábrica).
+   */
+  Configuracion( ) {
+  }
+
+  /**
+   * @brief Comprueba que unos ajustes están dentro de los rangos admitidos.
+   * @param a Ajustes a validar.
+   * @return true si son válidos.
+   */
+  static bool validar( const Ajustes & a ) {
+    if ( a.periodoMuestreoMs < 1000 || a.periodoMuestreoMs > 3600000UL ) return false;
+    if ( a.muestrasO3 > 100 ) return false;
+    if ( a.muestrasBateria > 100 ) return false;
+    // Rango permitido por el estándar: 20 ms a 10.24 s
+    if ( a.intervaloAnuncio < 32 || a.intervaloAnuncio > 16384 ) return false;
+    // La histéresis exige desactivar por debajo de la activación
+    if ( a.alarmaO3.desactivacion >= a.alarmaO3.activacion ) return false;
+    if ( a.alarmaCO2.desactivacion >= a.alarmaCO2.activacion ) return false;
+
+    // Potencias que acepta el nRF52840
+    const int8_t potencias[] = { -40, -20, -16, -12, -8, -4, 0, 2, 3, 4, 5, 6, 7, 8 };
+    for ( int8_t p : potencias ) {
+      if ( p == a.potenciaTx ) return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Serializa unos ajustes en el formato de la característica.
+   * @param a Ajustes de origen.
+   * @param datos Destino (al menos TAM_AJUSTES bytes).
+   */
+  static void codificar( const Ajustes & a, uint8_t * datos ) {
+    datos[0] = (uint8_t)( a.periodoMuestreoMs & 0xFF );
+    datos[1] = (uint8_t)( a.periodoMuestreoMs >> 8 );
+    datos[2] = (uint8_t)( a.periodoMuestreoMs >> 16 );
+    datos[3] = (uint8_t)( a.periodoMuestreoMs >> 24 );
+    datos[4] = a.muestrasO3;
+    datos[5] = a.muestrasBateria;
+    datos[6] = (uint8_t)( a.intervaloAnuncio & 0xFF );
+    datos[7] = (uint8_t)( a.intervaloAnuncio >> 8 );
+    datos[8] = (uint8_t) a.potenciaTx;
+    escribirU16( &datos[9], a.alarmaO3.activacion );
+    escribirU16( &datos[11], a.alarmaO3.desactivacion );
+    escribirU16( &datos[13], a.alarmaCO2.activacion );
+    escribirU16( &datos[15], a.alarmaCO2.desactivacion );
+  }
+
+  /**
+   * @brief Interpreta unos ajustes serializados y los valida.
+   * @param datos Bytes recibidos.
+   * @param len Número de bytes recibidos.
+   * @param a Destino de los ajustes.
+   * @return true si el tamaño es correcto y los valores son válidos.
+   */
+  static bool decodificar( const uint8_t * datos, uint16_t len, Ajustes & a ) {
+    if ( len != TAM_AJUSTES ) return false;
+    a.periodoMuestreoMs = (uint32_t) datos[0] | ( (uint32_t) datos[1] << 8 )
+      | ( (uint32_t) datos[2] << 16 ) | ( (uint32_t) datos[3] << 24 );
+    a.muestrasO3 = datos[4];
+    a.muestrasBateria = datos[5];
+    a.intervaloAnuncio = (uint16_t)( datos[6] | ( datos[7] << 8 ) );
+    a.potenciaTx = (int8_t) datos[8];
+    a.alarmaO3.activacion = leerU16( &datos[9] );
+    a.alarmaO3.desactivacion = leerU16( &datos[11] );
+    a.alarmaCO2.activacion = leerU16( &datos[13] );
+    a.alarmaCO2.desactivacion = leerU16( &datos[15] );
+    return validar( a );
+  }
+
+  /**
+   * @brief Recibe unos ajustes nuevos (desde el callback de escritura).
+   * @details No toca los ajustes activos: quedan pendientes hasta el siguiente ciclo.
+   * @param datos Bytes escritos por el cliente.
+   * @param len Número de bytes.
+   * @return true si se aceptaron.
+   */
+  bool recibir( const uint8_t * datos, uint16_t len ) {
+    Ajustes nuevos;
+    if ( ! decodificar( datos, len, nuevos ) ) return false;
+
+    noInterrupts();
+    pendientes = nuevos;
+    hayPendientes = true;
+    interrupts();
+    return true;
+  }
+
+  /**
+   * @brief Aplica los ajustes pendientes, si los hay.
+   * @details Debe llamarse solo en la frontera entre ciclos del loop().
+   * @return true si los ajustes activos han cambiado.
+   */
+  bool aplicarPendientes() {
+    if ( ! hayPendientes ) return false;
+
+    noInterrupts();
+    activos = pendientes;
+    hayPendientes = false;
+    interrupts();
+    return true;
+  }
+
+  /**
+   * @brief Ajustes en vigor durante el ciclo actual.
+   * @return Referencia constante a los ajustes activos.
+   */
+  const Ajustes & getAjustes() const {
+    return activos;
+  }
+
+  /**
+   * @brief Carga los ajustes guardados en la flash interna.
+   * @details Si no hay fichero o su contenido no es válido se mantienen los de fábrica.
+   * @return true si se cargaron ajustes guardados.
+   */
+  bool cargar() {
+    using namespace Adafruit_LittleFS_Namespace;
+
+    InternalFS.begin();
+    File fichero( InternalFS );
+    if ( ! fichero.open( FICHERO, FILE_O_READ ) ) return false;
+
+    uint8_t datos[1 + TAM_AJUSTES];
+    int leidos = fichero.read( datos, sizeof( datos ) );
+    fichero.close();
+
+    Ajustes guardados;
+    if ( leidos != (int) sizeof( datos ) || datos[0] != MARCA_FICHERO
+         || ! decodificar( &datos[1], TAM_AJUSTES, guardados ) ) {
+      return false;
+    }
+    activos = guardados;
+    return true;
+  }
+
+  /**
+   * @brief Guarda los ajustes activos en la flash interna.
+   * @details Se escriben en un fichero temporal que después se renombra sobre
+   * FICHERO: el renombrado de LittleFS es atómico, así que un corte de
+   * alimentación deja los ajustes anteriores o los nuevos, nunca ninguno.
+   * @return true si se escribieron correctamente.
+   */
+  bool guardar() {
+    using namespace Adafruit_LittleFS_Namespace;
+
+    uint8_t datos[1 + TAM_AJUSTES];
+    datos[0] = MARCA_FICHERO;
+    codificar( activos, &datos[1] );
+
+    // FILE_O_WRITE añade al final: se borran los restos de un guardado cortado
+    InternalFS.remove( FICHERO_TEMPORAL );
+    File fichero( InternalFS );
+    if ( ! fichero.open( FICHERO_TEMPORAL, FILE_O_WRITE ) ) return false;
+    size_t escritos = fichero.write( datos, sizeof( datos ) );
+    fichero.close();
+    if ( escritos != sizeof( datos ) ) {
+      InternalFS.remove( FICHERO_TEMPORAL );
+      return false;
+    }
+    return InternalFS.rename( FICHERO_TEMPORAL, FICHERO );
+  }
+
+}; // class
+
+#endif
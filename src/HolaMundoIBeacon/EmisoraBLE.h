@@ -3,12 +3,16 @@
  * @brief Clase para gestionar la publicidad y conexión de una emisora Bluetooth Low Energy (BLE).
  * @author Rocio
  * @date 11/11/2025
+ * @details Los anuncios son siempre clásicos en 1M: la librería de Adafruit
+ * no permite anuncios extendidos ni elegir su PHY. El PHY (1M, 2M o Coded) se
+ * elige por conexión con solicitarPHYConexion().
  */
 
 #ifndef EMISORA_H_INCLUIDO
 #define EMISORA_H_INCLUIDO
 
 #include "ServicioEnEmisora.h"
+#include "Perfilador.h"
 
 /**
  * @class EmisoraBLE
@@ -21,7 +25,8 @@ private:
 
   const char * nombreEmisora; ///< Nombre que se mostrará en el escaneo BLE.
   const uint16_t fabricanteID; ///< ID del fabricante (Company ID) para anuncios.
-  const int8_t txPower; ///< Potencia de transmisión en dBm.
+  int8_t txPower; ///< Potencia de transmisión en dBm.
+  uint16_t intervaloAnuncio = 100; ///< Intervalo de anuncio (unidades de 0.625 ms).
 
 public:
 
@@ -53,6 +58,31 @@ public:
   {
   }
 
+  /**
+   * @brief Cambia el intervalo de anuncio y la potencia de emisión.
+   * @details Se aplica a partir del siguiente anuncio que se emita.
+   * @param intervalo Intervalo de anuncio (unidades de 0.625 ms).
+   * @param potencia Potencia de transmisión en dBm.
+   */
+  void ajustarAnuncio( uint16_t intervalo, int8_t potencia ) {
+    (*this).intervaloAnuncio = intervalo;
+    (*this).txPower = potencia;
+  }
+
+  /**
+   * @brief Pide un PHY para una conexión, bajando a 1M si la radio o el central no lo admiten.
+   * @param connHandle Identificador de la conexión.
+   * @param phy PHY deseado (BLE_GAP_PHY_1MBPS, BLE_GAP_PHY_2MBPS o BLE_GAP_PHY_CODED).
+   * @return PHY pedido finalmente (0 si la pila tampoco aceptó 1M).
+   */
+  uint8_t solicitarPHYConexion( uint16_t connHandle, uint8_t phy ) {
+    BLEConnection * conexion = (*this).getConexion( connHandle );
+    if ( conexion == nullptr ) return 0;
+    if ( conexion->requestPHY( phy ) ) return phy;
+    if ( phy != BLE_GAP_PHY_1MBPS && conexion->requestPHY( BLE_GAP_PHY_1MBPS ) ) return BLE_GAP_PHY_1MBPS;
+    return 0;
+  }
+
   /**
    * @brief Inicializa el hardware Bluefruit y detiene anuncios previos.
    */
@@ -109,7 +139,7 @@ public:
 
     Bluefruit.Advertising.setBeacon( elBeacon );
     Bluefruit.Advertising.restartOnDisconnect(true);
-    Bluefruit.Advertising.setInterval(100, 100); 
+    Bluefruit.Advertising.setInterval( (*this).intervaloAnuncio, (*this).intervaloAnuncio ); 
 
     Bluefruit.Advertising.start( 0 ); 
   }
@@ -143,7 +173,7 @@ public:
                      4+21 );
 
     Bluefruit.Advertising.restartOnDisconnect(true);
-    Bluefruit.Advertising.setInterval(100, 100); 
+    Bluefruit.Advertising.setInterval( (*this).intervaloAnuncio, (*this).intervaloAnuncio ); 
     Bluefruit.Advertising.setFastTimeout( 1 ); 
     Bluefruit.Advertising.start( 0 ); 
 
@@ -155,13 +185,17 @@ public:
    * @details Útil para enviar tramas de sensores empaquetadas.
    * @param datos Puntero a los datos.
    * @param tamanyoDatos Longitud de los datos.
+   * @param intervalo Intervalo de anuncio (unidades de 0.625 ms); 0 para usar el configurado.
    */
-  void emitirDatosMultiples(const uint8_t *datos, const uint8_t tamanyoDatos) {
+  void emitirDatosMultiples(const uint8_t *datos, const uint8_t tamanyoDatos,
+              const uint16_t intervalo = 0) {
+    SONDA_TIEMPO( SONDA_EMITIR );
     (*this).detenerAnuncio(); 
 
     Bluefruit.Advertising.clearData();
     Bluefruit.ScanResponse.clearData(); 
 
+    Bluefruit.setTxPower( (*this).txPower );
     Bluefruit.setName( (*this).nombreEmisora );
     Bluefruit.ScanResponse.addName();
     Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE);
@@ -176,8 +210,10 @@ public:
                     &payload[0],
                     2 + tamanyoDatos );
 
+    const uint16_t elIntervalo = ( intervalo != 0 ? intervalo : (*this).intervaloAnuncio );
+
     Bluefruit.Advertising.restartOnDisconnect(true);
-    Bluefruit.Advertising.setInterval(100, 100);
+    Bluefruit.Advertising.setInterval( elIntervalo, elIntervalo );
     Bluefruit.Advertising.setFastTimeout( 1 );
     Bluefruit.Advertising.start( 0 ); 
   }
@@ -0,0 +1,427 @@
+/**
+ * @file GestorConexion.h
+ * @brief Gestión de los parámetros de conexión BLE mediante perfiles.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cuando un central se conecta, la pila negocia por defecto unos
+ * parámetros genéricos. Este gestor aplica perfiles con nombre (intervalo de
+ * conexión, latencia de esclavo, timeout de supervisión y PHY) y cambia
+ * automáticamente entre ellos según haya o no datos pendientes de enviar,
+ * guardando estadísticas de cada conexión. El PHY se pide a través de
+ * EmisoraBLE, que baja a 1M si el central no lo admite.
+ *
+ * El MTU y la longitud de datos (Data Length Extension) se piden una sola vez,
+ * al conectarse: ATT solo admite un intercambio de MTU por conexión y el MTU
+ * no puede bajar después, así que no forman parte de los perfiles.
+ *
+ * Los callbacks de conexión llegan desde la tarea BLE mientras el loop()
+ * recorre las conexiones, así que solo encolan el evento (con las
+ * interrupciones desactivadas, como Configuracion::recibir()) y es
+ * actualizar(), desde el loop(), quien lo aplica.
+ */
+
+#ifndef GESTOR_CONEXION_H_INCLUIDO
+#define GESTOR_CONEXION_H_INCLUIDO
+
+#include "EmisoraBLE.h"
+
+/**
+ * @struct PerfilConexion
+ * @brief Conjunto de parámetros de conexión que se solicitan al central.
+ */
+struct PerfilConexion {
+  const char * nombre;          ///< Nombre del perfil (para trazas).
+  uint16_t intervalo;           ///< Intervalo de conexión (unidades de 1.25 ms).
+  uint16_t latencia;            ///< Latencia de esclavo (eventos que se pueden saltar).
+  uint16_t timeoutSupervision;  ///< Timeout de supervisión (unidades de 10 ms).
+  uint8_t phy;                  ///< PHY solicitado (BLE_GAP_PHY_1MBPS, BLE_GAP_PHY_2MBPS...).
+};
+
+/// @brief MTU ATT que se pide al conectarse (una vez por conexión).
+const uint16_t MTU_CONEXION = 247;
+/// @brief Carga de PDU con Data Length Extension, que se pide al conectarse.
+const uint16_t LONGITUD_DATOS_CONEXION = 251;
+
+/**
+ * @brief Perfil "masivo": máximo caudal para descargas.
+ * @details Intervalo de 7.5 ms, sin latencia y PHY 2M.
+ */
+const PerfilConexion PERFIL_MASIVO = {
+  "masivo", 6, 0, 400, BLE_GAP_PHY_2MBPS
+};
+
+/**
+ * @brief Perfil "reposo": mínimo consumo cuando no hay nada que enviar.
+ * @details Intervalo de 500 ms con latencia 4 (la placa solo despierta cada 2.5 s)
+ * y timeout de 6 s, que cumple timeout > 2 * (1 + latencia) * intervalo.
+ */
+const PerfilConexion PERFIL_REPOSO = {
+  "reposo", 400, 4, 600, BLE_GAP_PHY_1MBPS
+};
+
+/**
+ * @brief Perfil de reposo para despliegues de largo alcance.
+ * @details Como PERFIL_REPOSO pero en PHY Coded, con timeout de 12 s para
+ * tolerar los paquetes que se pierden en el límite de cobertura.
+ */
+const PerfilConexion PERFIL_LARGO_ALCANCE = {
+  "largoAlcance", 400, 4, 1200, BLE_GAP_PHY_CODED
+};
+
+/**
+ * @struct EstadisticasConexion
+ * @brief Contadores de una conexión, desde que se establece hasta que termina.
+ */
+struct EstadisticasConexion {
+  bool activa = false;                        ///< true mientras la conexión existe.
+  uint16_t connHandle = 0xFFFF;               ///< Identificador de la conexión.
+  const PerfilConexion * perfil = nullptr;    ///< Perfil aplicado actualmente.
+  unsigned long momentoConexion = 0;          ///< millis() al conectarse.
+  unsigned long momentoCambioPerfil = 0;      ///< millis() del último cambio de perfil.
+  unsigned long msEnMasivo = 0;               ///< Tiempo acumulado en el perfil masivo.
+  unsigned long msEnReposo = 0;               ///< Tiempo acumulado en el perfil reposo.
+  uint16_t cambiosPerfil = 0;                 ///< Número de cambios de perfil.
+  uint16_t peticionesRechazadas = 0;          ///< Peticiones que la pila no aceptó.
+  uint8_t phy = 0;                            ///< PHY pedido finalmente (tras bajar a 1M si hizo falta).
+  uint32_t bytesEnviados = 0;                 ///< Bytes enviados por la conexión.
+  uint8_t motivoDesconexion = 0;              ///< Código de razón de la desconexión.
+};
+
+/**
+ * @struct EventoConexion
+ * @brief Conexión o desconexión recibida en un callback y aún sin aplicar.
+ */
+struct EventoConexion {
+  uint16_t connHandle;
+  bool establecida;          ///< true al conectarse, false al desconectarse.
+  uint8_t motivo;            ///< Código de razón de la desconexión.
+  unsigned long momento;     ///< millis() del callback.
+};
+
+/**
+ * @class GestorConexion
+ * @brief Aplica perfiles de conexión y conmuta entre ellos según los datos pendientes.
+ * @details Se engancha a los callbacks de conexión de EmisoraBLE. Mientras haya
+ * al menos umbralMasivo bytes pendientes se usa el perfil masivo; cuando no quedan
+ * datos y pasa esperaReposoMs sin novedades se vuelve al de reposo (por defecto
+ * PERFIL_MASIVO y PERFIL_REPOSO). Los datos se envían con notificar(), que
+ * lleva la cuenta de los bytes pendientes y enviados.
+ */
+class GestorConexion {
+
+public:
+  /// @brief Número máximo de conexiones simultáneas que se siguen.
+  static const int MAX_CONEXIONES = 2;
+  /// @brief Eventos de conexión que caben en la cola entre dos actualizar().
+  static const uint8_t MAX_EVENTOS = 2 * MAX_CONEXIONES;
+
+private:
+  EmisoraBLE & laEmisora;
+  EstadisticasConexion conexiones[MAX_CONEXIONES];
+
+  EventoConexion eventos[MAX_EVENTOS];   ///< Cola compartida con los callbacks.
+  volatile uint8_t numEventos = 0;
+  volatile uint16_t eventosPerdidos = 0; ///< Eventos que no cupieron en la cola.
+
+  uint32_t bytesPendientes = 0;          ///< Bytes que la aplicación tiene por enviar.
+  unsigned long momentoUltimoDato = 0;   ///< millis() de la última vez que hubo datos.
+  uint32_t umbralMasivo;                 ///< Bytes pendientes a partir de los que se pasa a masivo.
+  unsigned long esperaReposoMs;          ///< Inactividad tras la que se vuelve a reposo.
+  const PerfilConexion & perfilMasivo;   ///< Perfil cuando hay datos pendientes.
+  const PerfilConexion & perfilReposo;   ///< Perfil cuando no los hay.
+
+  /**
+   * @brief Busca las estadísticas de una conexión activa.
+   * @param connHandle Identificador de la conexión.
+   * @return Puntero a las estadísticas o nullptr si no se sigue esa conexión.
+   */
+  EstadisticasConexion * buscar( uint16_t connHandle ) {
+    for ( auto & c : conexiones ) {
+      if ( c.activa && c.connHandle == connHandle ) return &c;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Suma al perfil saliente el tiempo que ha estado aplicado.
+   */
+  void acumularTiempo( EstadisticasConexion & c, unsigned long ahora ) {
+    unsigned long transcurrido = ahora - c.momentoCambioPerfil;
+    if ( c.perfil == &perfilMasivo ) c.msEnMasivo += transcurrido;
+    else if ( c.perfil == &perfilReposo ) c.msEnReposo += transcurrido;
+    c.momentoCambioPerfil = ahora;
+  }
+
+  /**
+   * @brief Encola un evento (desde los callbacks de la tarea BLE).
+   */
+  void encolar( const EventoConexion & e ) {
+    noInterrupts();
+    if ( numEventos < MAX_EVENTOS ) eventos[numEventos++] = e;
+    else eventosPerdidos++;
+    interrupts();
+  }
+
+  /**
+   * @brief Aplica, en orden, los eventos encolados por los callbacks.
+   */
+  void procesarEventos() {
+    EventoConexion copia[MAX_EVENTOS];
+    uint8_t n;
+    uint16_t perdidos;
+    noInterrupts();
+    n = numEventos;
+    for ( uint8_t i = 0; i < n; i++ ) copia[i] = eventos[i];
+    numEventos = 0;
+    perdidos = eventosPerdidos;
+    eventosPerdidos = 0;
+    interrupts();
+
+    if ( perdidos > 0 ) {
+      Globales::elPuerto.escribir( "GestorConexion: eventos perdidos: " );
+      Globales::elPuerto.escribir( perdidos );
+      Globales::elPuerto.escribir( "\n" );
+    }
+    for ( uint8_t i = 0; i < n; i++ ) {
+      if ( copia[i].establecida ) abrir( copia[i] );
+      else cerrar( copia[i] );
+    }
+  }
+
+  /**
+   * @brief Empieza a seguir una conexión, siempre en reposo.
+   * @details Pide aquí, una sola vez, el MTU y la longitud de datos.
+   */
+  void abrir( const EventoConexion & e ) {
+    for ( auto & c : conexiones ) {
+      if ( ! c.activa ) {
+        c = EstadisticasConexion();
+        c.activa = true;
+        c.connHandle = e.connHandle;
+        c.momentoConexion = e.momento;
+        c.momentoCambioPerfil = e.momento;
+        BLEConnection * conexion = laEmisora.getConexion( c.connHandle );
+        if ( conexion != nullptr ) {
+          bool ok = conexion->requestDataLengthUpdate();
+          ok &= conexion->requestMtuExchange( MTU_CONEXION );
+          if ( ! ok ) c.peticionesRechazadas++;
+        }
+        aplicarPerfil( c, perfilReposo );
+        return;
+      }
+    }
+    Globales::elPuerto.escribir( "GestorConexion: sin hueco para la conexion\n" );
+  }
+
+  /**
+   * @brief Cierra las estadísticas de una conexión y las escribe por el puerto serie.
+   */
+  void cerrar( const EventoConexion & e ) {
+    EstadisticasConexion * c = buscar( e.connHandle );
+    if ( c == nullptr ) return;
+    acumularTiempo( *c, e.momento );
+    c->motivoDesconexion = e.motivo;
+    escribirEstadisticas( *c, e.momento );
+    c->activa = false;
+  }
+
+  /**
+   * @brief Solicita al central el PHY y los parámetros de conexión de un perfil.
+   * @param c Conexión a la que se aplica.
+   * @param perfil Perfil a aplicar.
+   */
+  void aplicarPerfil( EstadisticasConexion & c, const PerfilConexion & perfil ) {
+    BLEConnection * conexion = laEmisora.getConexion( c.connHandle );
+    if ( conexion == nullptr ) return;
+
+    c.phy = laEmisora.solicitarPHYConexion( c.connHandle, perfil.phy );
+    bool ok = ( c.phy != 0 );
+    ok &= conexion->requestConnectionParameter( perfil.intervalo,
+                                                perfil.latencia,
+                                                perfil.timeoutSupervision );
+    if ( ! ok ) c.peticionesRechazadas++;
+
+    acumularTiempo( c, millis() );
+    if ( c.perfil != nullptr ) c.cambiosPerfil++;
+    c.perfil = &perfil;
+
+    Globales::elPuerto.escribir( "Conexion " );
+    Globales::elPuerto.escribir( c.connHandle );
+    Globales::elPuerto.escribir( ": perfil " );
+    Globales::elPuerto.escribir( perfil.nombre );
+    Globales::elPuerto.escribir( "\n" );
+  }
+
+public:
+
+  /**
+   * @brief Constructor del gestor.
+   * @param emisora Emisora cuyas conexiones se gestionan.
+   * @param umbralMasivo_ Bytes pendientes a partir de los que se usa el perfil masivo.
+   * @param esperaReposoMs_ Milisegundos sin datos tras los que se vuelve a reposo.
+   * @param perfilMasivo_ Perfil cuando hay datos pendientes.
+   * @param perfilReposo_ Perfil cuando no los hay (p.ej. PERFIL_LARGO_ALCANCE).
+   */
+  GestorConexion( EmisoraBLE & emisora, uint32_t umbralMasivo_ = 64,
+                  unsigned long esperaReposoMs_ = 5000,
+                  const PerfilConexion & perfilMasivo_ = PERFIL_MASIVO,
+                  const PerfilConexion & perfilReposo_ = PERFIL_REPOSO )
+  :
+  laEmisora( emisora ) ,
+  umbralMasivo( umbralMasivo_ ) ,
+  esperaReposoMs( esperaReposoMs_ ) ,
+  perfilMasivo( perfilMasivo_ ) ,
+  perfilReposo( perfilReposo_ )
+  {
+  }
+
+  /**
+   * @brief Debe llamarse desde el callback de conexión establecida.
+   * @details Solo encola el evento: el siguiente actualizar() empieza a seguir
+   * la conexión en reposo y pasa a masivo si hace falta.
+   * @param connHandle Identificador de la conexión.
+   */
+  void alEstablecerConexion( uint16_t connHandle ) {
+    encolar( { connHandle, true, 0, millis() } );
+  }
+
+  /**
+   * @brief Debe llamarse desde el callback de conexión terminada.
+   * @details Solo encola el evento: el siguiente actualizar() cierra las
+   * estadísticas de la conexión y las escribe por el puerto serie.
+   * @param connHandle Identificador de la conexión.
+   * @param reason Código de razón de la desconexión.
+   */
+  void alTerminarConexion( uint16_t connHandle, uint8_t reason ) {
+    encolar( { connHandle, false, reason, millis() } );
+  }
+
+  /**
+   * @brief Anota bytes nuevos que la aplicación tiene por enviar.
+   * @param bytes Bytes que se suman a los pendientes.
+   */
+  void anyadirDatosPendientes( uint32_t bytes ) {
+    bytesPendientes += bytes;
+    if ( bytes > 0 ) momentoUltimoDato = millis();
+  }
+
+  /**
+   * @brief Descuenta de los pendientes bytes que ya no se van a enviar.
+   * @param bytes Bytes descartados (p.ej. un informe que no llegó a nadie y se sustituirá).
+   */
+  void descartarDatosPendientes( uint32_t bytes ) {
+    bytesPendientes = ( bytes >= bytesPendientes ? 0 : bytesPendientes - bytes );
+  }
+
+  /**
+   * @brief Bytes pendientes de enviar.
+   */
+  uint32_t getDatosPendientes() const {
+    return bytesPendientes;
+  }
+
+  /**
+   * @brief Anota bytes enviados por una conexión y los descuenta de los pendientes.
+   * @param connHandle Identificador de la conexión.
+   * @param bytes Bytes enviados.
+   */
+  void informarDatosEnviados( uint16_t connHandle, uint32_t bytes ) {
+    EstadisticasConexion * c = buscar( connHandle );
+    if ( c != nullptr ) c->bytesEnviados += bytes;
+    bytesPendientes = ( bytes >= bytesPendientes ? 0 : bytesPendientes - bytes );
+    momentoUltimoDato = millis();
+  }
+
+  /**
+   * @brief Notifica unos datos a todas las conexiones abiertas llevando la cuenta de bytes.
+   * @details Llama a actualizar() antes de enviar, de modo que un envío grande
+   * se hace con el perfil masivo. Conviene avisar antes con
+   * anyadirDatosPendientes() para dar tiempo a la negociación. Si alguna
+   * conexión los recibe, se descuentan de los pendientes; si no, siguen
+   * pendientes.
+   * @param caracteristica Característica con la propiedad Notify.
+   * @param datos Bytes a notificar.
+   * @param len Número de bytes.
+   * @return Conexiones a las que se enviaron.
+   */
+  uint8_t notificar( ServicioEnEmisora::Caracteristica & caracteristica, const uint8_t * datos, uint16_t len ) {
+    actualizar();
+
+    uint8_t enviadas = 0;
+    for ( auto & c : conexiones ) {
+      if ( c.activa && caracteristica.notificarDatos( c.connHandle, datos, len ) ) {
+        c.bytesEnviados += len;
+        enviadas++;
+      }
+    }
+    if ( enviadas > 0 ) {
+      bytesPendientes = ( len >= bytesPendientes ? 0 : bytesPendientes - len );
+      momentoUltimoDato = millis();
+    }
+    return enviadas;
+  }
+
+  /**
+   * @brief Aplica los eventos de conexión y decide el perfil de cada conexión según los datos pendientes.
+   * @details Se llama desde el loop() (también durante la espera del anuncio)
+   * y desde notificar().
+   */
+  void actualizar() {
+    procesarEventos();
+    unsigned long ahora = millis();
+    for ( auto & c : conexiones ) {
+      if ( ! c.activa ) continue;
+
+      const PerfilConexion * deseado = c.perfil;
+      if ( bytesPendientes >= umbralMasivo ) {
+        deseado = &perfilMasivo;
+      } else if ( bytesPendientes == 0 && ahora - momentoUltimoDato >= esperaReposoMs ) {
+        deseado = &perfilReposo;
+      }
+
+      if ( deseado != c.perfil ) {
+        aplicarPerfil( c, *deseado );
+      }
+    }
+  }
+
+  /**
+   * @brief Devuelve las estadísticas de una conexión activa.
+   * @param connHandle Identificador de la conexión.
+   * @return Puntero a las estadísticas o nullptr.
+   */
+  const EstadisticasConexion * getEstadisticas( uint16_t connHandle ) {
+    return buscar( connHandle );
+  }
+
+  /**
+   * @brief Escribe las estadísticas de una conexión por el puerto serie.
+   * @param c Estadísticas a mostrar.
+   * @param ahora millis() hasta el que se cuenta la duración.
+   */
+  void escribirEstadisticas( const EstadisticasConexion & c, unsigned long ahora ) {
+    using Globales::elPuerto;
+    elPuerto.escribir( "Conexion " );
+    elPuerto.escribir( c.connHandle );
+    elPuerto.escribir( " duracion(ms): " );
+    elPuerto.escribir( ahora - c.momentoConexion );
+    elPuerto.escribir( " masivo(ms): " );
+    elPuerto.escribir( c.msEnMasivo );
+    elPuerto.escribir( " reposo(ms): " );
+    elPuerto.escribir( c.msEnReposo );
+    elPuerto.escribir( " cambios: " );
+    elPuerto.escribir( c.cambiosPerfil );
+    elPuerto.escribir( " rechazos: " );
+    elPuerto.escribir( c.peticionesRechazadas );
+    elPuerto.escribir( " phy: " );
+    elPuerto.escribir( c.phy );
+    elPuerto.escribir( " bytes: " );
+    elPuerto.escribir( c.bytesEnviados );
+    elPuerto.escribir( " motivo: " );
+    elPuerto.escribir( c.motivoDesconexion );
+    elPuerto.escribir( "\n" );
+  }
+
+}; // class
+
+#endif
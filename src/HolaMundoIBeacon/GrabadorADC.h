@@ -0,0 +1,195 @@
+/**
+ * @file GrabadorADC.h
+ * @brief Grabación de las lecturas crudas del Medidor para reproducirlas en el ordenador.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cada lectura que hace el Medidor (analogRead() de O3_PIN_VGAS,
+ * O3_PIN_VREF y PIN_A6, y los random() de los valores simulados) se anota
+ * en un búfer pequeño que se vuelca al puerto serie o a un fichero de la
+ * memoria flash interna. El reproductor del ordenador (Simulador/reproductorADC.cpp)
+ * vuelve a pasar esas lecturas por el Medidor y obtiene exactamente las mismas medidas.
+ *
+ * **Formato:** cabecera "GTIADC1\0" + millis() al empezar (4 bytes, LE),
+ * y después un registro por lectura:
+ *
+ * | Byte 0 | [Bytes 1-4] | 2 bytes |
+ * |:------:|:-----------:|:-------:|
+ * | Etiqueta | Delta largo (ms, LE) | Valor (LE) |
+ *
+ * La etiqueta lleva en el bit 7 si la lectura empieza una medida nueva, en
+ * los bits 6-4 el canal y en los bits 3-0 los ms desde la lectura anterior.
+ * Si no caben (>= 15 ms) los bits 3-0 valen 15 y el delta va en los 4 bytes
+ * siguientes. Las lecturas de una misma medida están a 1-2 ms, así que casi
+ * todos los registros ocupan 3 bytes.
+ *
+ * **Puerto serie:** el texto de PuertoSerie sale por el mismo puerto, así que
+ * cada volcado va en un bloque MARCA_BLOQUE_TRAZA + longitud (1 byte) + datos.
+ * El texto nunca lleva el byte 0xFF (no existe en UTF-8), de modo que el
+ * reproductor recupera la traza de un volcado completo del puerto.
+ *
+ * **Flash:** el fichero queda abierto mientras dura la grabación; volcar(),
+ * que el loop() llama una vez por ciclo, lo sincroniza para que un corte de
+ * alimentación pierda como mucho el ciclo en curso.
+ */
+
+#ifndef GRABADOR_ADC_H_INCLUIDO
+#define GRABADOR_ADC_H_INCLUIDO
+
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+/// @brief Cabecera de los ficheros de trazas ADC.
+const char CABECERA_TRAZA_ADC[8] = { 'G', 'T', 'I', 'A', 'D', 'C', '1', '\0' };
+
+/**
+ * @brief Canales que se graban (bits 6-4 de la etiqueta).
+ */
+enum CanalADC : uint8_t {
+  CANAL_VGAS = 0,          ///< analogRead( O3_PIN_VGAS ).
+  CANAL_VREF = 1,          ///< analogRead( O3_PIN_VREF ).
+  CANAL_BATERIA = 2,       ///< analogRead( PIN_A6 ).
+  CANAL_CO2 = 3,           ///< random() de medirCO2().
+  CANAL_TEMPERATURA = 4,   ///< random() de medirTemperatura().
+  CANAL_O3_SIMULADO = 5    ///< random() de medirPPMSimulado().
+};
+
+/// @brief Inicio de cada bloque de la traza en el puerto serie.
+const uint8_t MARCA_BLOQUE_TRAZA[2] = { 0xFF, 0xA5 };
+
+const uint8_t MARCA_INICIO_MEDIDA = 0x80; ///< Bit 7 de la etiqueta.
+const uint8_t DELTA_LARGO = 15;           ///< Bits 3-0: el delta va aparte.
+
+/**
+ * @class GrabadorADC
+ * @brief Anota lecturas crudas y las vuelca por bloques.
+ */
+class GrabadorADC {
+
+private:
+  /// @brief Tamaño del búfer (se vuelca al llenarse).
+  static const uint8_t TAM_BUFER = 96;
+  /// @brief Tamaño máximo del fichero en flash (la InternalFS es pequeña).
+  static const uint32_t TAM_MAXIMO_FICHERO = 16 * 1024;
+
+  const char * fichero;      ///< nullptr = puerto serie.
+  Adafruit_LittleFS_Namespace::File archivo; ///< Abierto entre empezar() y el final de la grabación.
+  uint8_t bufer[TAM_BUFER];
+  uint8_t ocupados = 0;
+  uint32_t volcados = 0;     ///< Bytes ya escritos en el destino.
+  uint32_t ultimoMs = 0;
+  uint32_t muestras = 0;
+  bool activo = false;
+
+  /**
+   * @brief Escribe bytes en el destino (en el puerto serie, como un bloque).
+   */
+  void escribir( const uint8_t * datos, uint8_t n ) {
+    if ( fichero == nullptr ) {
+      Serial.write( MARCA_BLOQUE_TRAZA, sizeof( MARCA_BLOQUE_TRAZA ) );
+      Serial.write( n );
+      Serial.write( datos, n );
+    } else {
+      archivo.write( datos, n );
+    }
+    volcados += n;
+  }
+
+  /**
+   * @brief Escribe el búfer en el destino, sin sincronizar la flash.
+   * @details En flash deja de grabar (y cierra el fichero) al llegar a TAM_MAXIMO_FICHERO.
+   */
+  void vaciar() {
+    if ( ocupados == 0 ) return;
+    if ( fichero != nullptr && volcados + ocupados > TAM_MAXIMO_FICHERO ) {
+      archivo.close();
+      activo = false;
+    } else {
+      escribir( bufer, ocupados );
+    }
+    ocupados = 0;
+  }
+
+public:
+
+  /**
+   * @brief Crea un grabador.
+   * @param fichero_ Fichero de la flash interna, o nullptr para el puerto serie.
+   */
+  explicit GrabadorADC( const char * fichero_ = nullptr )
+  : fichero( fichero_ ), archivo( InternalFS )
+  {
+  }
+
+  /**
+   * @brief Empieza una traza nueva (borra el fichero anterior si lo hay).
+   */
+  void empezar() {
+    activo = false;
+    if ( fichero != nullptr ) {
+      archivo.close();
+      InternalFS.begin();
+      InternalFS.remove( fichero );
+      if ( ! archivo.open( fichero, FILE_O_WRITE ) ) return;
+    }
+    ocupados = 0;
+    volcados = 0;
+    muestras = 0;
+    ultimoMs = millis();
+
+    uint8_t cabecera[12];
+    memcpy( cabecera, CABECERA_TRAZA_ADC, 8 );
+    for ( int i = 0; i < 4; i++ ) cabecera[8 + i] = (uint8_t)( ultimoMs >> ( 8 * i ) );
+    escribir( cabecera, sizeof( cabecera ) );
+    activo = true;
+  }
+
+  /**
+   * @brief Anota una lectura.
+   * @param canal Canal de la lectura.
+   * @param valor Valor leído.
+   * @param inicio true si es la primera lectura de una medida.
+   */
+  void anotar( CanalADC canal, uint16_t valor, bool inicio ) {
+    if ( ! activo ) return;
+    if ( ocupados + 7 > TAM_BUFER ) vaciar();
+    if ( ! activo ) return;
+
+    uint32_t ahora = millis();
+    uint32_t delta = ahora - ultimoMs;
+    ultimoMs = ahora;
+
+    uint8_t etiqueta = (uint8_t)( ( inicio ? MARCA_INICIO_MEDIDA : 0 ) | ( canal << 4 ) );
+    if ( delta < DELTA_LARGO ) {
+      bufer[ocupados++] = etiqueta | (uint8_t) delta;
+    } else {
+      bufer[ocupados++] = etiqueta | DELTA_LARGO;
+      for ( int i = 0; i < 4; i++ ) bufer[ocupados++] = (uint8_t)( delta >> ( 8 * i ) );
+    }
+    bufer[ocupados++] = (uint8_t)( valor & 0xFF );
+    bufer[ocupados++] = (uint8_t)( valor >> 8 );
+    muestras++;
+  }
+
+  /**
+   * @brief Vuelca el búfer al destino y sincroniza el fichero de la flash.
+   * @details Pensado para llamarse una vez por ciclo: cada sincronización
+   * reescribe los metadatos del fichero.
+   */
+  void volcar() {
+    vaciar();
+    if ( fichero != nullptr && activo ) archivo.flush();
+  }
+
+  /**
+   * @brief Lecturas anotadas desde empezar().
+   */
+  uint32_t getMuestras() const { return muestras; }
+
+  /**
+   * @brief false si no se ha empezado o si la flash ya se llenó.
+   */
+  bool estaActivo() const { return activo; }
+
+}; // class
+
+#endif
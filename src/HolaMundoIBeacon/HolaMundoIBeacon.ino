@@ -8,6 +8,15 @@
  * **Historial de cambios:**
  * - 26/11/25: Implementación de lectura de sensores y gestión de batería.
  * - 09/01/26: Adaptación completa de comentarios para generación con Doxygen.
+ * - 18/10/26: Gestor de perfiles de conexión (masivo/reposo) con estadísticas.
+ * - 18/10/26: Cola de tramas que se descargan por notificación al conectarse un central.
+ * - 18/10/26: Servicio GATT de configuración (periodo, muestras, anuncio, potencia).
+ * - 18/10/26: Alarmas de O3/CO2 con histéresis y ráfaga de anuncios de alarma.
+ * - 18/10/26: Trama v2 con número de secuencia de 32 bits y tiempo desde el arranque.
+ * - 18/10/26: Grabación opcional de las lecturas crudas (compilar con GRABAR_ADC).
+ * - 18/10/26: Sondas de tiempo con informe por serie y GATT (compilar con PERFILAR).
+ * - 18/10/26: Número de lecturas promediadas automático según el ruido (Sobremuestreo.h;
+ *   informe por serie de cada ciclo compilando con INFORME_SOBREMUESTREO).
  * * Este programa gestiona la adquisición de datos de sensores de gas (Ozono), 
  * niveles de CO2, temperatura y estado de carga de batería, emitiendo dicha 
  * información mediante anuncios Bluetooth Low Energy (Beacons personalizados).
@@ -39,13 +48,70 @@ namespace Globales {
 #include "EmisoraBLE.h"
 #include "Publicador.h"
 #include "Medidor.h"
+#include "GestorConexion.h"
+#include "Configuracion.h"
+#include "Alarma.h"
+#include "Trama.h"
+#include "ColaMedidas.h"
 
 namespace Globales {
   /// Objeto encargado de gestionar la emisión de anuncios BLE.
   Publicador elPublicador;
 
+  /// Aplica los perfiles de conexión cuando un central se conecta.
+  GestorConexion elGestorConexion ( elPublicador.laEmisora );
+
   /// Objeto encargado de realizar las mediciones de los sensores analógicos y digitales.
   Medidor elMedidor;
+
+  /// Ajustes modificables en caliente (se guardan en la flash interna).
+  Configuracion laConfiguracion;
+
+  /// Vigila los umbrales de O3 y CO2 en cada muestra nueva.
+  EvaluadorAlarmas elEvaluador;
+
+  /// Servicio GATT que expone los ajustes.
+  ServicioEnEmisora elServicioConfiguracion ( "GTI-PROY-3A-CONF" );
+
+  /// Característica de lectura/escritura con los ajustes serializados.
+  ServicioEnEmisora::Caracteristica laCaracteristicaAjustes (
+    "GTI-PROY-3A-AJUS",
+    CHR_PROPS_READ | CHR_PROPS_WRITE,
+    SECMODE_OPEN,
+    SECMODE_OPEN,
+    Configuracion::TAM_AJUSTES
+  );
+
+  /// Tramas pendientes de descargar por conexión.
+  ColaMedidas laColaMedidas;
+
+  /// Característica de lectura y notificación por la que se descarga la cola (una trama v2 por notificación).
+  ServicioEnEmisora::Caracteristica laCaracteristicaMedidas (
+    "GTI-PROY-3A-MEDI",
+    CHR_PROPS_READ | CHR_PROPS_NOTIFY,
+    SECMODE_OPEN,
+    SECMODE_NO_ACCESS,
+    TAM_TRAMA_V2
+  );
+
+#ifdef GRABAR_ADC
+  /// Graba las lecturas crudas del Medidor en la flash (ver GrabadorADC.h).
+  GrabadorADC elGrabador ( "/traza_adc.bin" );
+#endif
+
+#ifdef PERFILAR
+  /// Servicio GATT de diagnóstico.
+  ServicioEnEmisora elServicioDiagnostico ( "GTI-PROY-3A-DIAG" );
+
+  /// Característica de lectura y notificación con el informe de las sondas (ver Perfilador.h).
+  ServicioEnEmisora::Caracteristica laCaracteristicaSondas (
+    "GTI-PROY-3A-SOND",
+    CHR_PROPS_READ | CHR_PROPS_NOTIFY,
+    SECMODE_OPEN,
+    SECMODE_NO_ACCESS,
+    TAM_INFORME_SONDAS
+  );
+#endif
 }
 
 /**
@@ -59,6 +125,51 @@ void inicializarPlaquita () {
   pinMode(PIN_A6, INPUT);      // Pin de monitorización de Batería
 }
 
+/**
+ * @brief Callback de conexión establecida: la delega en el gestor de conexión.
+ * @param connHandle Identificador de la conexión.
+ */
+void alEstablecerConexion( uint16_t connHandle ) {
+  Globales::elGestorConexion.alEstablecerConexion( connHandle );
+}
+
+/**
+ * @brief Callback de conexión terminada: la delega en el gestor de conexión.
+ * @param connHandle Identificador de la conexión.
+ * @param reason Código de razón de la desconexión.
+ */
+void alTerminarConexion( uint16_t connHandle, uint8_t reason ) {
+  Globales::elGestorConexion.alTerminarConexion( connHandle, reason );
+}
+
+/**
+ * @brief Callback de escritura de la característica de ajustes.
+ * @details Solo valida y deja los ajustes pendientes; se aplican en el siguiente ciclo.
+ */
+void alEscribirAjustes( uint16_t conn_handle, BLECharacteristic * chr,
+            uint8_t * data, uint16_t len ) {
+  (void) conn_handle;
+  (void) chr;
+  if ( ! Globales::laConfiguracion.recibir( data, len ) ) {
+    Globales::elPuerto.escribir( "Ajustes rechazados\n" );
+  }
+}
+
+/**
+ * @brief Lleva los ajustes activos a la emisora y a la característica.
+ */
+void aplicarAjustes() {
+  using namespace Globales;
+  const Ajustes & ajustes = laConfiguracion.getAjustes();
+
+  elPublicador.laEmisora.ajustarAnuncio( ajustes.intervaloAnuncio, ajustes.potenciaTx );
+  elEvaluador.configurarUmbrales( ajustes.alarmaO3, ajustes.alarmaCO2 );
+
+  uint8_t datos[ Configuracion::TAM_AJUSTES ];
+  Configuracion::codificar( ajustes, datos );
+  laCaracteristicaAjustes.escribirDatos( datos, sizeof( datos ) );
+}
+
 /**
  * @brief Función de configuración inicial (Arduino Setup).
  * @details Inicializa periféricos, establece la semilla aleatoria para simulaciones,
@@ -72,10 +183,29 @@ void setup() {
   randomSeed(analogRead(0)); 
 
   // Activación del servicio BLE
-  Globales::elPublicador.encenderEmisora();
+  Globales::elPublicador.encenderEmisora( alEstablecerConexion, alTerminarConexion );
+
+  // Servicio de configuración y ajustes guardados
+  Globales::laConfiguracion.cargar();
+  Globales::laCaracteristicaAjustes.instalarCallbackCaracteristicaEscrita( alEscribirAjustes );
+  Globales::elPublicador.laEmisora.anyadirServicioConSusCaracteristicasYActivar(
+    Globales::elServicioConfiguracion, Globales::laCaracteristicaAjustes, Globales::laCaracteristicaMedidas );
+  aplicarAjustes();
+
+#ifdef PERFILAR
+  iniciarContadorTiempo();
+  reiniciarSondas();
+  Globales::elPublicador.laEmisora.anyadirServicioConSusCaracteristicasYActivar(
+    Globales::elServicioDiagnostico, Globales::laCaracteristicaSondas );
+#endif
+
+#ifdef GRABAR_ADC
+  Globales::elGrabador.empezar();
+  Globales::elMedidor.setGrabador( &Globales::elGrabador );
+#endif
 
   // Inicialización y calibración del medidor de gas
-  Globales::elMedidor.iniciarMedidor();
+  Globales::elMedidor.iniciarMedidor( MUESTRAS_AUTOMATICAS );
   esperar( 1000 );
 
   float vref_calibrado = Globales::elMedidor.getVrefBase();  
@@ -105,36 +235,164 @@ inline void lucecitas() {
  * @brief Variables persistentes relativas al ciclo de vida del loop.
  */
 namespace Loop {
-  uint8_t cont = 0; ///< Contador incremental de ciclos de medición.
+  uint32_t cont = 0; ///< Contador incremental de ciclos de medición.
+
+  Medidas ultimas;   ///< Últimas medidas (y secuencia de la última trama emitida).
+
+  uint32_t ultimoMillis = 0; ///< millis() en la última llamada a segundosDesdeArranque().
+  uint64_t acumuladoMs = 0;  ///< Milisegundos acumulados desde el arranque.
+}
+
+/**
+ * @brief Segundos transcurridos desde el arranque.
+ * @details Acumula los incrementos de millis() para no verse afectado por su
+ * desbordamiento cada 49.7 días (basta con llamarla una vez por ciclo).
+ * @return Segundos desde el arranque.
+ */
+uint32_t segundosDesdeArranque() {
+  using namespace Loop;
+  uint32_t ahora = millis();
+  acumuladoMs += (uint32_t)( ahora - ultimoMillis );
+  ultimoMillis = ahora;
+  return (uint32_t)( acumuladoMs / 1000 );
+}
+
+/**
+ * @brief Empaqueta las últimas medidas en una trama v2 nueva (ver Trama.h).
+ * @details Cada trama distinta recibe el siguiente número de secuencia; las
+ * repeticiones del mismo anuncio comparten el suyo.
+ * @param datos_payload Destino (TAM_TRAMA_V2 bytes).
+ * @param alarmas Máscara de alarmas activas (ALARMA_O3 / ALARMA_CO2).
+ */
+void empaquetarMedidas( uint8_t * datos_payload, uint8_t alarmas ) {
+  using namespace Loop;
+  SONDA_TIEMPO( SONDA_EMPAQUETAR );
+
+  ultimas.alarmas = alarmas;
+  ultimas.secuencia++;
+  ultimas.segundos = segundosDesdeArranque();
+  empaquetarTrama( datos_payload, ultimas );
+
+  // También a la cola de descarga (si estaba llena, los bytes pendientes no cambian)
+  if ( Globales::laColaMedidas.anyadir( datos_payload ) ) {
+    Globales::elGestorConexion.anyadirDatosPendientes( TAM_TRAMA_V2 );
+  }
+}
+
+/**
+ * @brief Envía la cola de tramas a los centrales conectados.
+ * @details Una trama por notificación, de la más antigua a la más nueva.
+ * Para en cuanto nadie la recibe (sin conexión, sin suscripción o con la cola
+ * de la pila llena): lo que queda se envía en la siguiente llamada.
+ */
+void enviarColaMedidas() {
+  using namespace Globales;
+  while ( ! laColaMedidas.vacia() ) {
+    const uint8_t * trama = laColaMedidas.getPrimera();
+    if ( elGestorConexion.notificar( laCaracteristicaMedidas, trama, TAM_TRAMA_V2 ) == 0 ) break;
+    laCaracteristicaMedidas.escribirDatos( trama, TAM_TRAMA_V2 );
+    laColaMedidas.quitar();
+  }
+}
+
+/**
+ * @brief Emite una ráfaga de anuncios de alarma a alta frecuencia.
+ * @details Usa el intervalo mínimo (20 ms) durante DURACION_RAFAGA_MS para que
+ * el aviso llegue cuanto antes a cualquier receptor cercano.
+ */
+void emitirRafagaAlarma() {
+  using namespace Globales;
+
+  uint8_t datos_payload[TAM_TRAMA_V2] = {0};
+  empaquetarMedidas( datos_payload, elEvaluador.getActivas() );
+
+  elPuerto.escribir( "**** ALARMA: " );
+  elPuerto.escribir( elEvaluador.getActivas() );
+  elPuerto.escribir( "\n" );
+
+  elPublicador.laEmisora.emitirDatosMultiples( datos_payload, sizeof(datos_payload), INTERVALO_RAFAGA );
+  esperar( DURACION_RAFAGA_MS );
+  elPublicador.laEmisora.detenerAnuncio();
+}
+
+/**
+ * @brief Mantiene el anuncio durante el periodo de muestreo vigilando las alarmas.
+ * @details Cada PERIODO_VIGILANCIA_MS toma una muestra nueva de O3 y CO2. Si
+ * alguna alarma se activa, interrumpe la espera y emite la ráfaga de alarma.
+ * @param periodoMs Duración total de la espera (ms).
+ * @param muestrasO3 Lecturas promediadas en cada muestra de O3.
+ * @return true si la espera se interrumpió por una alarma.
+ */
+bool esperarVigilando( unsigned long periodoMs, int muestrasO3 ) {
+  using namespace Globales;
+
+  unsigned long inicio = millis();
+  while ( millis() - inicio < periodoMs ) {
+    unsigned long quedan = periodoMs - ( millis() - inicio );
+    esperar( quedan < PERIODO_VIGILANCIA_MS ? quedan : PERIODO_VIGILANCIA_MS );
+
+    Loop::ultimas.o3ppb = (uint16_t)( elMedidor.medirPPM( muestrasO3 ) * 1000.0f );
+    Loop::ultimas.co2ppm = (uint16_t) elMedidor.medirCO2();
+    elGestorConexion.actualizar();
+    enviarColaMedidas();
+
+    if ( elEvaluador.evaluar( Loop::ultimas.o3ppb, Loop::ultimas.co2ppm ) != 0 ) {
+      emitirRafagaAlarma();
+      return true;
+    }
+  }
+  return false;
 }
 
 /**
  * @brief Bucle principal de ejecución (Arduino Loop).
  * @details Realiza las siguientes acciones:
- * 1. Lee los sensores (O3, CO2, Temp, Batería).
- * 2. Empaqueta los datos en un array de 9 bytes (Little Endian).
- * 3. Emite la información mediante un anuncio BLE durante 30 segundos.
- * * **Estructura del Payload (9 bytes):**
- * | Byte 0 | Bytes 1-2 | Bytes 3-4 | Bytes 5-6 | Bytes 7-8 |
- * |:------:|:---------:|:---------:|:---------:|:---------:|
- * | ID(0xAA)| O3 (ppb)  | Temp (x10)| CO2 (ppm) | Bat (%)   |
+ * 1. Aplica los ajustes recibidos por BLE durante el ciclo anterior.
+ * 2. Lee los sensores (O3, CO2, Temp, Batería) y evalúa las alarmas.
+ * 3. Empaqueta los datos en una trama v2 de 17 bytes (ver Trama.h).
+ * 4. Emite la información mediante un anuncio BLE durante el periodo de muestreo
+ *    (30 segundos por defecto), tomando muestras nuevas para vigilar las alarmas.
+ * 5. Si salta una alarma, emite una ráfaga de alarma y empieza un ciclo nuevo.
+ * * **Estructura del Payload (17 bytes, Little Endian):**
+ * | Byte 0 | Byte 1 | Bytes 2-5 | Bytes 6-8 | Bytes 9-10 | Bytes 11-12 | Bytes 13-14 | Bytes 15-16 |
+ * |:------:|:------:|:---------:|:---------:|:----------:|:-----------:|:-----------:|:-----------:|
+ * | ID(0xAB) | Alarmas | Secuencia | Tiempo (s) | O3 (ppb) | Temp (x10) | CO2 (ppm) | Bat (%) |
  */
 void loop () {
   using namespace Loop;
   using namespace Globales;
 
+  // Frontera de ciclo: único punto en el que cambian los ajustes
+  if ( laConfiguracion.aplicarPendientes() ) {
+    aplicarAjustes();
+    laConfiguracion.guardar();
+    elPuerto.escribir( "Ajustes nuevos aplicados\n" );
+  }
+  const Ajustes & ajustes = laConfiguracion.getAjustes();
+
   cont++;
   elPuerto.escribir( "\n---- loop(): empieza " );
   elPuerto.escribir( cont );
   elPuerto.escribir( "\n" );
 
+#ifdef PERFILAR
+  // El informe de las sondas sale al final de este ciclo: se avisa ya para
+  // que dé tiempo a negociar el perfil masivo
+  if ( cont % CICLOS_INFORME_SONDAS == 0 ) elGestorConexion.anyadirDatosPendientes( TAM_INFORME_SONDAS );
+#endif
+
+  // Ajustar el perfil de las conexiones abiertas (si las hay)
+  elGestorConexion.actualizar();
+
+  elMedidor.getAjuste().empezarCiclo();
+
   lucecitas();
 
   // --- Adquisición de Medidas ---
-  float valorO3 = elMedidor.medirPPM(); 
+  float valorO3 = elMedidor.medirPPM( ajustes.muestrasO3 ); 
   int valorCO2 = elMedidor.medirCO2();
   int valorTemperatura = elMedidor.medirTemperatura();
-  int valorBateria = elMedidor.medirBateria();
+  int valorBateria = elMedidor.medirBateria( ajustes.muestrasBateria );
 
   // Mostrar datos por puerto serie para depuración
   elPuerto.escribir( "O3 (ppm): " );
@@ -143,36 +401,54 @@ void loop () {
   
   // --- Empaquetado de Datos ---
   // O3 se guarda en ppb (partes por billón) multiplicando ppm por 1000
-  uint16_t O3_pack = (uint16_t)(valorO3 * 1000.0f); 
-  uint16_t Temp_pack = (uint16_t)valorTemperatura; 
-  uint16_t CO2_pack = (uint16_t)valorCO2; 
-  uint16_t Bat_pack = (uint16_t)valorBateria;
-
-  uint8_t datos_payload[9] = {0};
-  datos_payload[0] = 0xAA; // Cabecera identificadora del protocolo
-
-  // Empaquetado Little Endian (Byte bajo primero)
-  datos_payload[1] = (uint8_t)(O3_pack & 0xFF);
-  datos_payload[2] = (uint8_t)(O3_pack >> 8);
+  ultimas.o3ppb = (uint16_t)(valorO3 * 1000.0f); 
+  ultimas.temperaturaX10 = (uint16_t)valorTemperatura; 
+  ultimas.co2ppm = (uint16_t)valorCO2; 
+  ultimas.bateria = (uint16_t)valorBateria;
 
-  datos_payload[3] = (uint8_t)(Temp_pack & 0xFF);
-  datos_payload[4] = (uint8_t)(Temp_pack >> 8);
+  // --- Alarmas ---
+  if ( elEvaluador.evaluar( ultimas.o3ppb, ultimas.co2ppm ) != 0 ) {
+    emitirRafagaAlarma();
+  }
 
-  datos_payload[5] = (uint8_t)(CO2_pack & 0xFF);
-  datos_payload[6] = (uint8_t)(CO2_pack >> 8);
-
-  datos_payload[7] = (uint8_t)(Bat_pack & 0xFF);
-  datos_payload[8] = (uint8_t)(Bat_pack >> 8);
+  uint8_t datos_payload[TAM_TRAMA_V2] = {0};
+  empaquetarMedidas( datos_payload, elEvaluador.getActivas() );
 
   // --- Emisión BLE ---
   elPublicador.laEmisora.emitirDatosMultiples(datos_payload, sizeof(datos_payload));
+
+  // --- Descarga por conexión de las tramas pendientes ---
+  enviarColaMedidas();
   
-  esperar( 30000 ); // Mantener el anuncio activo 30 segundos
+  // Mantener el anuncio activo durante el periodo (o hasta que salte una alarma)
+  esperarVigilando( ajustes.periodoMuestreoMs, ajustes.muestrasO3 );
 
   elPublicador.laEmisora.detenerAnuncio();
 
+#ifdef INFORME_SOBREMUESTREO
+  // Lecturas, precisión y tiempo de ADC del ciclo
+  elMedidor.getAjuste().escribirInforme( elPuerto );
+#endif
+
+#ifdef GRABAR_ADC
+  elGrabador.volcar();
+#endif
+
+#ifdef PERFILAR
+  if ( cont % CICLOS_INFORME_SONDAS == 0 ) {
+    uint8_t informe[TAM_INFORME_SONDAS];
+    escribirInformeSondas( elPuerto );
+    uint8_t len = serializarSondas( informe );
+    laCaracteristicaSondas.escribirDatos( informe, len );
+    if ( elGestorConexion.notificar( laCaracteristicaSondas, informe, len ) == 0 ) {
+      // Nadie lo recibió: el siguiente informe lo sustituye
+      elGestorConexion.descartarDatosPendientes( len );
+    }
+  }
+#endif
+
   elPuerto.escribir( "---- loop(): acaba **** " );
   elPuerto.escribir( cont );
   elPuerto.escribir( "\n" );
   
-} // loop ()
\ No newline at end of file
+} // loop ()
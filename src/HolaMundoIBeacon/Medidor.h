@@ -6,6 +6,8 @@
  * @details Este archivo contiene la lógica para calcular concentraciones de O3 
  * mediante un sensor electroquímico, así como la estimación del nivel de batería
  * y la generación de datos simulados para CO2 y Temperatura.
+ * Con nAvg = MUESTRAS_AUTOMATICAS el número de lecturas promediadas lo decide
+ * AjusteSobremuestreo según el ruido de cada canal (ver Sobremuestreo.h).
  */
 
 #ifndef MEDIDOR_H_INCLUIDO
@@ -13,6 +15,9 @@
 
 #include <Arduino.h>
 #include <math.h>
+#include "GrabadorADC.h"
+#include "Perfilador.h"
+#include "Sobremuestreo.h"
 
 // ===================== CONSTANTES DE CONFIGURACIÓN (O3) =====================
 
@@ -69,6 +74,18 @@ const float BATT_MIN_VOLTS = 3.30f; ///< Voltaje LiPo al 0%.
 const float VDD = 3.30f;            ///< Referencia de voltaje del sistema (V).
 const int ADC_BITS = 10;            ///< Resolución ADC para batería.
 
+// ===================== AJUSTE DEL SOBREMUESTREO =====================
+
+/// @brief ppb de O3 que vale un código del ADC de ozono (unos 13.3).
+const float PPB_POR_CODIGO_O3 = 1000.0f * O3_VDD / ((1 << O3_ADC_BITS) - 1) / (GAIN_TIA * -SENSIBILIDAD_SENSOR * 1e-6f);
+/// @brief Puntos de porcentaje de batería que vale un código de su ADC (unos 0.72).
+const float PORCENTAJE_POR_CODIGO_BATERIA = VDD / ((1 << ADC_BITS) - 1) * 2.0f / (BATT_MAX_VOLTS - BATT_MIN_VOLTS) * 100.0f;
+
+// Sin dither no se baja de ±LSB/2 (unos ±6.65 ppb de O3, ver Sobremuestreo.h)
+const float PRECISION_O3_PPB = 10.0f;       ///< Precisión deseada de cada medida de O3 (± ppb).
+const float PRECISION_VREF_PPB = 7.0f;      ///< Precisión de la calibración (su error se suma a todas las medidas).
+const float PRECISION_BATERIA = 1.0f;       ///< Precisión deseada de la batería (± puntos de %).
+
 /**
  * @class Medidor
  * @brief Se encarga de la adquisición y procesamiento de datos ambientales.
@@ -79,17 +96,69 @@ class Medidor {
 
 private:
   float _Vref_base = 0.0f; ///< Valor de calibración inicial de VREF.
+  GrabadorADC * _grabador = nullptr; ///< Grabador de lecturas crudas (opcional).
+  AjusteSobremuestreo _ajuste; ///< Número de lecturas de las medidas automáticas.
+
+  /**
+   * @brief Lee un pin analógico y, si hay grabador, anota la lectura.
+   * @param pin Pin analógico a leer.
+   * @param inicio true si es la primera lectura de la medida.
+   * @return Código ADC leído.
+   */
+  int leerADC(int pin, bool inicio) {
+    int raw = analogRead(pin);
+    if (_grabador != nullptr) {
+      _grabador->anotar(canalDePin(pin), (uint16_t)raw, inicio);
+    }
+    return raw;
+  }
+
+  /**
+   * @brief Canal (de GrabadorADC y AjusteSobremuestreo) de un pin analógico.
+   */
+  static CanalADC canalDePin(int pin) {
+    return (pin == O3_PIN_VGAS ? CANAL_VGAS : pin == O3_PIN_VREF ? CANAL_VREF : CANAL_BATERIA);
+  }
+
+  /**
+   * @brief Promedia lecturas de un pin.
+   * @param pin Pin analógico a leer.
+   * @param nAvg Número de lecturas, o MUESTRAS_AUTOMATICAS para que lo decida el ajuste.
+   * @param esperaMs Espera tras cada lectura (ms).
+   * @return Código ADC medio.
+   */
+  float promediarADC(int pin, int nAvg, unsigned long esperaMs) {
+    if (nAvg == MUESTRAS_AUTOMATICAS) {
+      AjusteSobremuestreo::Medida m = _ajuste.empezar(canalDePin(pin));
+      int raw;
+      do { raw = leerADC(pin, m.n == 0); delay(esperaMs); } while (_ajuste.anyadir(m, raw));
+      return _ajuste.terminar(m);
+    }
+    long acc = 0;
+    for (int i=0; i<nAvg; ++i) { acc += leerADC(pin, i == 0); delay(esperaMs); }
+    return (float)acc / nAvg;
+  }
+
+  /**
+   * @brief Elige un índice aleatorio y, si hay grabador, lo anota.
+   * @param canal Canal con el que se graba.
+   * @param n Número de valores posibles.
+   * @return Índice en [0, n).
+   */
+  int aleatorio(CanalADC canal, int n) {
+    int indice = (int)random(0, n);
+    if (_grabador != nullptr) _grabador->anotar(canal, (uint16_t)indice, true);
+    return indice;
+  }
 
   /**
    * @brief Lee el voltaje de un pin analógico promediando varias muestras.
    * @param pin Pin analógico a leer.
-   * @param nAvg Número de muestras para el promedio.
+   * @param nAvg Número de muestras para el promedio (o MUESTRAS_AUTOMATICAS).
    * @return Voltaje calculado en Voltios.
    */
   float leerVolt(int pin, int nAvg = 10) {
-    long acc = 0;
-    for (int i=0; i<nAvg; ++i) { acc += analogRead(pin); delay(2); }
-    const float raw = (float)acc / nAvg;
+    const float raw = promediarADC(pin, nAvg, 2);
     const float fullScale = (float)((1 << O3_ADC_BITS) - 1); 
     return (raw * O3_VDD) / fullScale;
   }
@@ -100,11 +169,29 @@ public:
    * @brief Constructor por defecto.
    */
   Medidor(  ) {
+    _ajuste.configurarCanal(CANAL_VGAS, "vgas", "ppb", PPB_POR_CODIGO_O3, PRECISION_O3_PPB, 100, 200);
+    _ajuste.configurarCanal(CANAL_VREF, "vref", "ppb", PPB_POR_CODIGO_O3, PRECISION_VREF_PPB, 250, 500);
+    _ajuste.configurarCanal(CANAL_BATERIA, "bateria", "%", PORCENTAJE_POR_CODIGO_BATERIA, PRECISION_BATERIA, 50, 50);
+  }
+
+  /**
+   * @brief Ajuste del sobremuestreo (objetivos, estado y estadísticas del ciclo).
+   */
+  AjusteSobremuestreo & getAjuste() {
+    return _ajuste;
+  }
+
+  /**
+   * @brief Graba desde ahora todas las lecturas crudas (ver GrabadorADC.h).
+   * @param grabador Grabador ya empezado, o nullptr para dejar de grabar.
+   */
+  void setGrabador(GrabadorADC * grabador) {
+    _grabador = grabador;
   }
 
   /**
    * @brief Calibra el medidor obteniendo el voltaje de referencia inicial.
-   * @param nAvg Número de muestras para la calibración (por defecto 50).
+   * @param nAvg Número de muestras para la calibración (por defecto 50; o MUESTRAS_AUTOMATICAS).
    */
   void iniciarMedidor(int nAvg = 50) {
        _Vref_base = leerVolt(O3_PIN_VREF, nAvg);
@@ -113,16 +200,20 @@ public:
   /**
    * @brief Calcula el porcentaje de carga de la batería real.
    * @details Utiliza un divisor de tensión 2:1 en el pin A6.
+   * @param nAvg Número de muestras para el promedio (o MUESTRAS_AUTOMATICAS).
    * @return Porcentaje de batería (0-100).
    */
-  int medirBateria() {
-      const int nAvg = 10;
-      long rawAcc = 0;
-      for (int i = 0; i < nAvg; ++i) { 
-          rawAcc += analogRead(PIN_A6); 
-          delay(1); 
-      }
-      const float rawAvg = (float)rawAcc / nAvg;
+  int medirBateria(int nAvg = 10) {
+      SONDA_TIEMPO(SONDA_MEDIR_BATERIA);
+      return porcentajeBateria(promediarADC(PIN_A6, nAvg, 1));
+  }
+
+  /**
+   * @brief Convierte la lectura media del pin A6 en porcentaje de batería.
+   * @param rawAvg Código medio del ADC.
+   * @return Porcentaje de batería (0-100).
+   */
+  static int porcentajeBateria(float rawAvg) {
       const float fullScale = (float)((1 << ADC_BITS) - 1); 
       float measuredVolts = (rawAvg * VDD) / fullScale;
       
@@ -143,7 +234,7 @@ public:
    * @return Valor de CO2 en ppm.
    */
   int medirCO2() {
-    int indiceAleatorio = random(0, NUM_CO2_VALORES); 
+    int indiceAleatorio = aleatorio(CANAL_CO2, NUM_CO2_VALORES); 
     return CO2_SIMULADO[indiceAleatorio];
   }
 
@@ -152,7 +243,7 @@ public:
    * @return Temperatura (ºC * 10).
    */
   int medirTemperatura() {
-    int indiceAleatorio = random(0, NUM_TEMP_VALORES);
+    int indiceAleatorio = aleatorio(CANAL_TEMPERATURA, NUM_TEMP_VALORES);
     return TEMP_SIMULADA[indiceAleatorio];
   }
   
@@ -166,7 +257,7 @@ public:
 
   /**
    * @brief Lee el voltaje actual en el pin Vgas del sensor de O3.
-   * @param nAvg Número de muestras para el promedio.
+   * @param nAvg Número de muestras para el promedio (o MUESTRAS_AUTOMATICAS).
    * @return Voltaje en Voltios.
    */
   float leerVgas(int nAvg = 10) { 
@@ -178,7 +269,7 @@ public:
    * @return Valor de ozono en ppm (float).
    */
   float medirPPMSimulado() {
-    int indiceAleatorio = random(0, NUM_O3_VALORES);
+    int indiceAleatorio = aleatorio(CANAL_O3_SIMULADO, NUM_O3_VALORES);
     float valorSimuladoRaw = (float)O3_SIMULADO[indiceAleatorio];      
     return valorSimuladoRaw / 1000.0f;
   }
@@ -187,11 +278,22 @@ public:
    * @brief Realiza la medición real de Ozono (O3) en ppm.
    * @details Calcula la diferencia entre Vgas y Vref, convierte a corriente y 
    * aplica las constantes de sensibilidad y corrección (slope/offset).
+   * @param nAvg Número de muestras para el promedio de Vgas (o MUESTRAS_AUTOMATICAS).
+   * @return Concentración de ozono corregida en ppm.
+   */
+  float medirPPM(int nAvg = 10) {
+    SONDA_TIEMPO(SONDA_MEDIR_PPM);
+    return ppmDesdeVoltios(leerVolt(O3_PIN_VGAS, nAvg), _Vref_base);
+  }
+
+  /**
+   * @brief Convierte los voltajes del sensor de O3 en concentración.
+   * @param Vg Voltaje de Vgas (V).
+   * @param Vref Voltaje de referencia calibrado (V).
    * @return Concentración de ozono corregida en ppm.
    */
-  float medirPPM() {
-    float Vg = leerVolt(O3_PIN_VGAS, 10);
-    float deltaV = Vg - _Vref_base;
+  static float ppmDesdeVoltios(float Vg, float Vref) {
+    float deltaV = Vg - Vref;
         
     float denominador = GAIN_TIA * SENSIBILIDAD_SENSOR * 1e-6f; 
         
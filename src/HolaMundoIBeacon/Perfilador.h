@@ -0,0 +1,232 @@
+/**
+ * @file Perfilador.h
+ * @brief Sondas de tiempo para los caminos calientes del firmware.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Una sonda mide lo que tarda el bloque en que se declara:
+ *
+ *     SONDA_TIEMPO( SONDA_MEDIR_PPM );
+ *
+ * Cada pasada se mide de dos formas:
+ * - **CPU**: en la placa, el contador de ciclos DWT del Cortex-M4 (1 ciclo =
+ *   1/64 µs, leerlo cuesta una instrucción); en el ordenador, std::chrono.
+ *   El DWT se para mientras el núcleo duerme (WFI/WFE) y con FreeRTOS delay()
+ *   duerme, así que solo cuenta el tiempo en que la CPU está ocupada.
+ * - **Pared**: micros(), que sigue contando mientras se duerme (en el
+ *   ordenador, el reloj virtual de la placa simulada). Es lo que hay que
+ *   mirar en medirPPM() y medirBateria(), que pasan casi todo el tiempo en delay().
+ *
+ * Cada sonda acumula en una tabla estática el número de pasadas, el mínimo,
+ * el máximo y la media de CPU, la media y el máximo de pared y un histograma
+ * en potencias de 2 de µs de CPU.
+ *
+ * Solo se compila si se define PERFILAR; sin él SONDA_TIEMPO() no genera
+ * código y la tabla no ocupa memoria.
+ *
+ * **Informe binario (TAM_REGISTRO_SONDA bytes por sonda, Little Endian):**
+ * | Bytes 0-3 | Bytes 4-7 | Bytes 8-11 | Bytes 12-15 | Bytes 16-19 | Bytes 20-23 | Bytes 24-55 |
+ * |:---------:|:---------:|:----------:|:-----------:|:-----------:|:-----------:|:-----------:|
+ * | Pasadas | Mínimo CPU (µs) | Media CPU (µs) | Máximo CPU (µs) | Media pared (µs) | Máximo pared (µs) | NUM_CUBETAS x u16 |
+ */
+
+#ifndef PERFILADOR_H_INCLUIDO
+#define PERFILADOR_H_INCLUIDO
+
+#include <Arduino.h>
+
+/**
+ * @brief Puntos del firmware que se miden.
+ */
+enum SondaId : uint8_t {
+  SONDA_MEDIR_PPM = 0,     ///< Medidor::medirPPM().
+  SONDA_MEDIR_BATERIA,     ///< Medidor::medirBateria().
+  SONDA_EMPAQUETAR,        ///< empaquetarMedidas() del sketch.
+  SONDA_EMITIR,            ///< EmisoraBLE::emitirDatosMultiples().
+  NUM_SONDAS
+};
+
+#ifdef PERFILAR
+
+#include "PuertoSerie.h"
+
+#if defined( __arm__ ) && defined( ARDUINO )
+/// @brief Ciclos del DWT por µs (nRF52 a 64 MHz).
+const uint32_t TICKS_POR_US = 64;
+
+/**
+ * @brief Pone en marcha el contador de ciclos DWT.
+ */
+inline void iniciarContadorTiempo() {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/// @brief Lee el contador de ciclos (da la vuelta cada 67 s).
+inline uint32_t leerContadorTiempo() { return DWT->CYCCNT; }
+#else
+#include <chrono>
+
+/// @brief ns por µs (en el ordenador se cuentan ns).
+const uint32_t TICKS_POR_US = 1000;
+
+inline void iniciarContadorTiempo() {}
+
+/// @brief Lee el reloj monótono en ns (da la vuelta cada 4.3 s).
+inline uint32_t leerContadorTiempo() {
+  return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+#endif
+
+/// @brief Nombres de las sondas para el informe por el puerto serie.
+const char * const NOMBRES_SONDAS[NUM_SONDAS] = { "medirPPM", "medirBateria", "empaquetar", "emitir" };
+
+/// @brief Cubetas del histograma: la c cuenta las pasadas de [2^c, 2^(c+1)) µs de CPU (la 0 incluye < 1 µs).
+const uint8_t NUM_CUBETAS = 16;
+/// @brief Bytes de cada sonda en el informe binario.
+const uint8_t TAM_REGISTRO_SONDA = 24 + 2 * NUM_CUBETAS;
+/// @brief Bytes del informe binario completo (cabe en una notificación con MTU 247).
+const uint8_t TAM_INFORME_SONDAS = NUM_SONDAS * TAM_REGISTRO_SONDA;
+/// @brief Cada cuántos ciclos del loop() se exporta el informe.
+const uint32_t CICLOS_INFORME_SONDAS = 10;
+
+/**
+ * @struct EstadisticasSonda
+ * @brief Contadores de una sonda (CPU en ticks de leerContadorTiempo(), pared en µs).
+ */
+struct EstadisticasSonda {
+  uint32_t pasadas;
+  uint32_t minimo;
+  uint32_t maximo;
+  uint64_t suma;
+  uint64_t sumaParedUs;
+  uint32_t maximoParedUs;
+  uint32_t cubetas[NUM_CUBETAS];
+
+  /**
+   * @brief Acumula una pasada.
+   * @param ticks Tiempo de CPU de la pasada.
+   * @param paredUs Tiempo de pared de la pasada (µs).
+   */
+  void anotar( uint32_t ticks, uint32_t paredUs ) {
+    if ( pasadas == 0 || ticks < minimo ) minimo = ticks;
+    if ( ticks > maximo ) maximo = ticks;
+    suma += ticks;
+    sumaParedUs += paredUs;
+    if ( paredUs > maximoParedUs ) maximoParedUs = paredUs;
+    pasadas++;
+
+    uint32_t us = ticks / TICKS_POR_US;
+    uint8_t c = 0;
+    while ( us >= 2 && c < NUM_CUBETAS - 1 ) { us >>= 1; c++; }
+    cubetas[c]++;
+  }
+};
+
+/**
+ * @brief Tabla estática con una entrada por sonda.
+ */
+inline EstadisticasSonda * tablaSondas() {
+  static EstadisticasSonda tabla[NUM_SONDAS];
+  return tabla;
+}
+
+/**
+ * @brief Pone a cero todas las sondas.
+ */
+inline void reiniciarSondas() {
+  memset( tablaSondas(), 0, sizeof( EstadisticasSonda ) * NUM_SONDAS );
+}
+
+/**
+ * @class SondaTiempo
+ * @brief Mide desde su construcción hasta su destrucción (fin del bloque).
+ */
+class SondaTiempo {
+private:
+  uint8_t id;
+  uint32_t inicio;
+  uint32_t inicioParedUs;
+
+public:
+  explicit SondaTiempo( SondaId id_ ) : id( id_ ), inicio( leerContadorTiempo() ), inicioParedUs( micros() ) {}
+
+  ~SondaTiempo() {
+    tablaSondas()[id].anotar( leerContadorTiempo() - inicio, (uint32_t)( micros() - inicioParedUs ) );
+  }
+};
+
+#define SONDA_CONCATENAR2( a, b ) a##b
+#define SONDA_CONCATENAR( a, b ) SONDA_CONCATENAR2( a, b )
+/// @brief Mide el resto del bloque actual con la sonda indicada.
+#define SONDA_TIEMPO( id ) SondaTiempo SONDA_CONCATENAR( laSonda_, __LINE__ )( id )
+
+/**
+ * @brief Escribe el informe de las sondas como texto.
+ * @param puerto Puerto serie de destino.
+ */
+inline void escribirInformeSondas( PuertoSerie & puerto ) {
+  for ( uint8_t i = 0; i < NUM_SONDAS; i++ ) {
+    const EstadisticasSonda & e = tablaSondas()[i];
+    if ( e.pasadas == 0 ) continue;
+    puerto.escribir( "sonda " );
+    puerto.escribir( NOMBRES_SONDAS[i] );
+    puerto.escribir( ": n=" );
+    puerto.escribir( (unsigned long) e.pasadas );
+    puerto.escribir( " cpu min=" );
+    puerto.escribir( (unsigned long)( e.minimo / TICKS_POR_US ) );
+    puerto.escribir( "us media=" );
+    puerto.escribir( (unsigned long)( e.suma / e.pasadas / TICKS_POR_US ) );
+    puerto.escribir( "us max=" );
+    puerto.escribir( (unsigned long)( e.maximo / TICKS_POR_US ) );
+    puerto.escribir( "us pared media=" );
+    puerto.escribir( (unsigned long)( e.sumaParedUs / e.pasadas ) );
+    puerto.escribir( "us max=" );
+    puerto.escribir( (unsigned long) e.maximoParedUs );
+    puerto.escribir( "us hist=" );
+    for ( uint8_t c = 0; c < NUM_CUBETAS; c++ ) {
+      if ( c > 0 ) puerto.escribir( ',' );
+      puerto.escribir( (unsigned long) e.cubetas[c] );
+    }
+    puerto.escribir( "\n" );
+  }
+}
+
+/**
+ * @brief Serializa las sondas para la característica de diagnóstico.
+ * @param destino Búfer de TAM_INFORME_SONDAS bytes.
+ * @return Bytes escritos.
+ */
+inline uint8_t serializarSondas( uint8_t * destino ) {
+  uint8_t * p = destino;
+  for ( uint8_t i = 0; i < NUM_SONDAS; i++ ) {
+    const EstadisticasSonda & e = tablaSondas()[i];
+    uint32_t campos[6] = {
+      e.pasadas,
+      e.minimo / TICKS_POR_US,
+      e.pasadas > 0 ? (uint32_t)( e.suma / e.pasadas / TICKS_POR_US ) : 0,
+      e.maximo / TICKS_POR_US,
+      e.pasadas > 0 ? (uint32_t)( e.sumaParedUs / e.pasadas ) : 0,
+      e.maximoParedUs
+    };
+    for ( uint32_t v : campos ) {
+      for ( int k = 0; k < 4; k++ ) *p++ = (uint8_t)( v >> ( 8 * k ) );
+    }
+    for ( uint8_t c = 0; c < NUM_CUBETAS; c++ ) {
+      uint16_t v = e.cubetas[c] > 0xFFFF ? 0xFFFF : (uint16_t) e.cubetas[c];
+      *p++ = (uint8_t)( v & 0xFF );
+      *p++ = (uint8_t)( v >> 8 );
+    }
+  }
+  return (uint8_t)( p - destino );
+}
+
+#else
+
+/// @brief Sin PERFILAR las sondas desaparecen.
+#define SONDA_TIEMPO( id ) ((void) 0)
+
+#endif
+
+#endif
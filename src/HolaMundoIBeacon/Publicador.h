@@ -63,6 +63,15 @@ public:
   Publicador( ) {
   } 
 
+  /**
+   * @brief Calcula el campo Major de un anuncio.
+   * @param id Tipo de medición (8 bits altos).
+   * @param contador Valor incremental (8 bits bajos).
+   */
+  static uint16_t calcularMajor( MedicionesID id, uint8_t contador ) {
+    return (uint16_t)( ( id << 8 ) + contador );
+  }
+
   /**
    * @brief Activa el hardware de la emisora BLE.
    */
@@ -70,6 +79,16 @@ public:
     (*this).laEmisora.encenderEmisora();
   } 
 
+  /**
+   * @brief Activa la emisora BLE instalando los callbacks de conexión.
+   * @param cbce Callback para cuando se establece una conexión.
+   * @param cbct Callback para cuando se pierde una conexión.
+   */
+  void encenderEmisora( EmisoraBLE::CallbackConexionEstablecida cbce,
+              EmisoraBLE::CallbackConexionTerminada cbct ) {
+    (*this).laEmisora.encenderEmisora( cbce, cbct );
+  } 
+
   /**
    * @brief Publica una medición de CO2.
    * @param valorCO2 Valor de la medición a enviar (se coloca en el campo Minor).
@@ -81,7 +100,7 @@ public:
           long tiempoEspera ) {
 
     // 1. Calculamos el campo Major (ID + Contador)
-    uint16_t major = (MedicionesID::CO2 << 8) + contador;
+    uint16_t major = calcularMajor( MedicionesID::CO2, contador );
     
     // 2. Emitimos el anuncio iBeacon
     (*this).laEmisora.emitirAnuncioIBeacon( (*this).beaconUUID, 
@@ -104,7 +123,7 @@ public:
   void publicarTemperatura( int16_t valorTemperatura,
                 uint8_t contador, long tiempoEspera ) {
 
-    uint16_t major = (MedicionesID::TEMPERATURA << 8) + contador;
+    uint16_t major = calcularMajor( MedicionesID::TEMPERATURA, contador );
     
     (*this).laEmisora.emitirAnuncioIBeacon( (*this).beaconUUID, 
                       major,
@@ -127,6 +127,14 @@ public:
      */
     uint16_t escribirDatos( const char * str ) { return laCaracteristica.write( str ); }
 
+    /**
+     * @brief Escribe datos binarios de forma local en la característica.
+     * @param datos Puntero a los bytes a escribir.
+     * @param len Número de bytes.
+     * @return Número de bytes escritos.
+     */
+    uint16_t escribirDatos( const uint8_t * datos, uint16_t len ) { return laCaracteristica.write( datos, len ); }
+
     /**
      * @brief Envía una notificación a los clientes suscritos.
      * @param str Datos a notificar.
@@ -134,6 +142,25 @@ public:
      */
     uint16_t notificarDatos( const char * str ) { return laCaracteristica.notify( str ); }
 
+    /**
+     * @brief Envía una notificación binaria a los clientes suscritos.
+     * @param datos Puntero a los bytes a notificar.
+     * @param len Número de bytes.
+     * @return Resultado de la operación de notificación.
+     */
+    uint16_t notificarDatos( const uint8_t * datos, uint16_t len ) { return laCaracteristica.notify( datos, len ); }
+
+    /**
+     * @brief Envía una notificación binaria a un cliente concreto.
+     * @param connHandle Identificador de la conexión.
+     * @param datos Puntero a los bytes a notificar.
+     * @param len Número de bytes.
+     * @return true si la pila aceptó la notificación (el cliente está suscrito).
+     */
+    bool notificarDatos( uint16_t connHandle, const uint8_t * datos, uint16_t len ) {
+      return laCaracteristica.notify( connHandle, datos, len );
+    }
+
     /**
      * @brief Configura el callback de escritura.
      * @param cb Función a ejecutar cuando un cliente escribe datos.
@@ -0,0 +1,279 @@
+/**
+ * @file Sobremuestreo.h
+ * @brief Elección automática del número de lecturas promediadas según el ruido.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Con un número fijo de lecturas se pierde tiempo de ADC si la señal
+ * está limpia y no se llega a la precisión si está sucia. El ajuste estima
+ * la varianza de una lectura de cada canal (media móvil exponencial entre
+ * medidas) y para de leer en cuanto
+ *
+ *     n >= ( COBERTURA_AJUSTE * sigma / objetivo )^2
+ *
+ * es decir, cuando la media alcanza la precisión objetivo (± con un 95 %
+ * aproximadamente), con un mínimo de MUESTRAS_MINIMAS_AJUSTE lecturas y un
+ * tope de lecturas y de tiempo por canal. La decisión usa solo la varianza
+ * aprendida de las medidas anteriores (la primera, la suya propia): si
+ * dependiera de las lecturas de la medida en curso, las que por azar salen
+ * parecidas pararían antes y la precisión declarada sería optimista. La
+ * varianza nunca baja de la de cuantización (1/12 LSB^2).
+ *
+ * El ADC no tiene dither: si el ruido es menor que un código, todas las
+ * lecturas dan el mismo y promediar no quita el error de redondeo. Por eso la
+ * precisión declarada nunca baja de ±LSB/2 (resolucion()) y un objetivo más
+ * fino que eso se sube a ±LSB/2.
+ *
+ * La media es la suma entera de las lecturas entre n, la misma cuenta que
+ * hace el Medidor con un número fijo: una traza grabada en modo automático
+ * se reproduce bit a bit con el número de lecturas de cada medida.
+ *
+ * Cada ciclo del loop() acumula, por canal, las medidas, las lecturas, la
+ * precisión conseguida y el tiempo de ADC, y escribirInforme() lo saca por
+ * el puerto serie (el sketch solo lo llama si se compila con
+ * INFORME_SOBREMUESTREO).
+ */
+
+#ifndef SOBREMUESTREO_H_INCLUIDO
+#define SOBREMUESTREO_H_INCLUIDO
+
+#include <Arduino.h>
+#include <math.h>
+#include "GrabadorADC.h"
+#include "PuertoSerie.h"
+
+/// @brief Valor de nAvg con el que el Medidor elige solo el número de lecturas.
+const int MUESTRAS_AUTOMATICAS = 0;
+
+/// @brief Canales que se ajustan: CANAL_VGAS, CANAL_VREF y CANAL_BATERIA.
+const uint8_t NUM_CANALES_AJUSTE = 3;
+/// @brief Lecturas mínimas de una medida (para poder estimar su varianza).
+const uint16_t MUESTRAS_MINIMAS_AJUSTE = 4;
+/// @brief Errores típicos de la media que abarca la precisión (2 = 95 % aprox.).
+const float COBERTURA_AJUSTE = 2.0f;
+/// @brief Peso de cada medida nueva en la media móvil de la varianza.
+const float SUAVIZADO_VARIANZA = 0.25f;
+/// @brief Varianza de cuantización del ADC (LSB^2).
+const float VARIANZA_CUANTIZACION = 1.0f / 12.0f;
+
+/**
+ * @struct CanalAjuste
+ * @brief Objetivo, estado y estadísticas del ciclo de un canal.
+ */
+struct CanalAjuste {
+  // --- Configuración ---
+  const char * nombre = "";          ///< Nombre para el informe.
+  const char * unidad = "";          ///< Unidad de la precisión (p.ej. "ppb").
+  float unidadesPorCodigo = 1.0f;    ///< Unidades que vale un código del ADC.
+  float objetivo = 1.0f;             ///< Precisión deseada (± unidades).
+  uint16_t maxMuestras = 100;        ///< Tope de lecturas por medida.
+  uint32_t maxTiempoUs = 200000;     ///< Tope de tiempo de ADC por medida (µs).
+
+  // --- Estado ---
+  float varianza = 0.0f;             ///< Varianza estimada de una lectura (LSB^2).
+  bool conVarianza = false;          ///< false hasta la primera medida.
+
+  // --- Estadísticas del ciclo ---
+  uint16_t medidas = 0;
+  uint32_t muestras = 0;
+  uint16_t minimoMuestras = 0;
+  uint16_t maximoMuestras = 0;
+  uint16_t recortadas = 0;           ///< Medidas que pararon por un tope sin llegar al objetivo.
+  float sumaPrecision = 0.0f;
+  float peorPrecision = 0.0f;
+  uint32_t tiempoUs = 0;             ///< Tiempo de ADC (lecturas y esperas).
+};
+
+/**
+ * @class AjusteSobremuestreo
+ * @brief Decide cuántas lecturas promediar en cada medida.
+ * @details Uso desde el Medidor:
+ *
+ *     AjusteSobremuestreo::Medida m = ajuste.empezar( canal );
+ *     do { codigo = analogRead( pin ); delay( 2 ); } while ( ajuste.anyadir( m, codigo ) );
+ *     float codigoMedio = ajuste.terminar( m );
+ */
+class AjusteSobremuestreo {
+
+public:
+  /**
+   * @struct Medida
+   * @brief Medida en curso (suma de las lecturas, y media y suma de cuadrados de Welford).
+   */
+  struct Medida {
+    uint8_t canal;
+    uint16_t n;
+    long suma;
+    float media;
+    float m2;
+    unsigned long inicioUs;
+    float precision;     ///< Precisión conseguida (± unidades), la rellena terminar().
+  };
+
+private:
+  CanalAjuste canales[NUM_CANALES_AJUSTE];
+
+  /**
+   * @brief Varianza de una lectura: la aprendida o, si aún no hay, la de la medida en curso.
+   */
+  float estimarVarianza( const CanalAjuste & c, const Medida & m ) const {
+    float v = c.conVarianza ? c.varianza : ( m.n > 1 ? m.m2 / ( m.n - 1 ) : 0.0f );
+    return v > VARIANZA_CUANTIZACION ? v : VARIANZA_CUANTIZACION;
+  }
+
+  /**
+   * @brief Medio código del ADC en las unidades del canal.
+   */
+  static float mitadLSB( const CanalAjuste & c ) {
+    return 0.5f * c.unidadesPorCodigo;
+  }
+
+public:
+
+  /**
+   * @brief Configura un canal.
+   * @param canal CANAL_VGAS, CANAL_VREF o CANAL_BATERIA.
+   * @param nombre Nombre para el informe.
+   * @param unidad Unidad de la precisión.
+   * @param unidadesPorCodigo Unidades que vale un código del ADC.
+   * @param objetivo Precisión deseada (± unidades; no baja de ±LSB/2).
+   * @param maxMuestras Tope de lecturas por medida.
+   * @param maxTiempoMs Tope de tiempo por medida (ms).
+   */
+  void configurarCanal( uint8_t canal, const char * nombre, const char * unidad, float unidadesPorCodigo,
+                        float objetivo, uint16_t maxMuestras, uint32_t maxTiempoMs ) {
+    if ( canal >= NUM_CANALES_AJUSTE ) return;
+    CanalAjuste & c = canales[canal];
+    c.nombre = nombre;
+    c.unidad = unidad;
+    c.unidadesPorCodigo = unidadesPorCodigo;
+    c.objetivo = objetivo > mitadLSB( c ) ? objetivo : mitadLSB( c );
+    c.maxMuestras = maxMuestras < MUESTRAS_MINIMAS_AJUSTE ? MUESTRAS_MINIMAS_AJUSTE : maxMuestras;
+    c.maxTiempoUs = maxTiempoMs * 1000UL;
+  }
+
+  /**
+   * @brief Cambia la precisión deseada de un canal (no baja de ±LSB/2).
+   */
+  void setObjetivo( uint8_t canal, float objetivo ) {
+    if ( canal >= NUM_CANALES_AJUSTE || objetivo <= 0.0f ) return;
+    CanalAjuste & c = canales[canal];
+    c.objetivo = objetivo > mitadLSB( c ) ? objetivo : mitadLSB( c );
+  }
+
+  /**
+   * @brief Precisión más fina que se puede declarar en un canal (± unidades).
+   * @details Sin dither, ±LSB/2: es el error de redondeo de una señal sin ruido.
+   */
+  float resolucion( uint8_t canal ) const {
+    return mitadLSB( getCanal( canal ) );
+  }
+
+  /**
+   * @brief Configuración, estado y estadísticas de un canal.
+   */
+  const CanalAjuste & getCanal( uint8_t canal ) const {
+    return canales[canal < NUM_CANALES_AJUSTE ? canal : 0];
+  }
+
+  /**
+   * @brief Empieza una medida.
+   */
+  Medida empezar( uint8_t canal ) {
+    Medida m = { (uint8_t)( canal < NUM_CANALES_AJUSTE ? canal : 0 ), 0, 0, 0.0f, 0.0f, micros(), 0.0f };
+    return m;
+  }
+
+  /**
+   * @brief Añade una lectura a la medida.
+   * @return true si hace falta otra lectura.
+   */
+  bool anyadir( Medida & m, int codigo ) {
+    m.n++;
+    m.suma += codigo;
+    float delta = codigo - m.media;
+    m.media += delta / m.n;
+    m.m2 += delta * ( codigo - m.media );
+
+    const CanalAjuste & c = canales[m.canal];
+    if ( m.n < MUESTRAS_MINIMAS_AJUSTE ) return true;
+    if ( m.n >= c.maxMuestras || micros() - m.inicioUs >= c.maxTiempoUs ) return false;
+
+    float objetivoCodigos = c.objetivo / c.unidadesPorCodigo;
+    float necesarias = COBERTURA_AJUSTE * COBERTURA_AJUSTE * estimarVarianza( c, m ) / ( objetivoCodigos * objetivoCodigos );
+    return m.n < necesarias;
+  }
+
+  /**
+   * @brief Cierra la medida: aprende su varianza y la suma a las estadísticas del ciclo.
+   * @return Código medio (suma / n, como con un número fijo de lecturas).
+   */
+  float terminar( Medida & m ) {
+    CanalAjuste & c = canales[m.canal];
+    if ( m.n == 0 ) return 0.0f;
+
+    m.precision = COBERTURA_AJUSTE * sqrtf( estimarVarianza( c, m ) / m.n ) * c.unidadesPorCodigo;
+    if ( m.precision < mitadLSB( c ) ) m.precision = mitadLSB( c );
+    if ( m.n > 1 ) {
+      float s2 = m.m2 / ( m.n - 1 );
+      c.varianza = c.conVarianza ? c.varianza + SUAVIZADO_VARIANZA * ( s2 - c.varianza ) : s2;
+      c.conVarianza = true;
+    }
+
+    if ( c.medidas == 0 || m.n < c.minimoMuestras ) c.minimoMuestras = m.n;
+    if ( m.n > c.maximoMuestras ) c.maximoMuestras = m.n;
+    if ( m.precision > c.objetivo ) c.recortadas++;
+    if ( m.precision > c.peorPrecision ) c.peorPrecision = m.precision;
+    c.medidas++;
+    c.muestras += m.n;
+    c.sumaPrecision += m.precision;
+    c.tiempoUs += micros() - m.inicioUs;
+    return (float) m.suma / m.n;
+  }
+
+  /**
+   * @brief Pone a cero las estadísticas del ciclo (lo aprendido se conserva).
+   */
+  void empezarCiclo() {
+    for ( CanalAjuste & c : canales ) {
+      c.medidas = 0;
+      c.muestras = 0;
+      c.minimoMuestras = 0;
+      c.maximoMuestras = 0;
+      c.recortadas = 0;
+      c.sumaPrecision = 0.0f;
+      c.peorPrecision = 0.0f;
+      c.tiempoUs = 0;
+    }
+  }
+
+  /**
+   * @brief Escribe las estadísticas del ciclo de los canales usados.
+   * @param puerto Puerto serie de destino.
+   */
+  void escribirInforme( PuertoSerie & puerto ) const {
+    for ( const CanalAjuste & c : canales ) {
+      if ( c.medidas == 0 ) continue;
+      puerto.escribir( "ajuste " );
+      puerto.escribir( c.nombre );
+      puerto.escribir( ": medidas=" );
+      puerto.escribir( (unsigned long) c.medidas );
+      puerto.escribir( " lecturas=" );
+      puerto.escribir( (unsigned long) c.minimoMuestras );
+      puerto.escribir( "-" );
+      puerto.escribir( (unsigned long) c.maximoMuestras );
+      puerto.escribir( " precision=+-" );
+      puerto.escribir( c.sumaPrecision / c.medidas );
+      puerto.escribir( " " );
+      puerto.escribir( c.unidad );
+      puerto.escribir( " (peor +-" );
+      puerto.escribir( c.peorPrecision );
+      puerto.escribir( ") recortadas=" );
+      puerto.escribir( (unsigned long) c.recortadas );
+      puerto.escribir( " adc(ms)=" );
+      puerto.escribir( (unsigned long)( c.tiempoUs / 1000 ) );
+      puerto.escribir( "\n" );
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file Trama.h
+ * @brief Formato del payload de sensores que viaja en los anuncios BLE.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details El mismo anuncio se repite cada 62.5 ms durante todo el ciclo, por
+ * lo que un receptor ve cientos de copias. La versión 2 de la trama añade un
+ * número de secuencia de 32 bits (uno por payload distinto) y el tiempo desde
+ * el arranque, de modo que la pasarela puede descartar las copias mirando
+ * solo 4 bytes en una posición fija, sin decodificar nada más.
+ *
+ * **Trama v2 (17 bytes, Little Endian):**
+ * | Byte 0 | Byte 1 | Bytes 2-5 | Bytes 6-8 | Bytes 9-10 | Bytes 11-12 | Bytes 13-14 | Bytes 15-16 |
+ * |:------:|:------:|:---------:|:---------:|:----------:|:-----------:|:-----------:|:-----------:|
+ * | ID(0xAB) | Alarmas | Secuencia | Tiempo (s) | O3 (ppb) | Temp (x10) | CO2 (ppm) | Bat (%) |
+ *
+ * La trama v1 (ID 0xAA: O3, Temp, CO2, Bat y, opcionalmente, Alarmas) se
+ * sigue pudiendo leer para las placas que no se hayan actualizado.
+ *
+ * No depende de Arduino: la comparten el firmware y las herramientas del ordenador.
+ */
+
+#ifndef TRAMA_H_INCLUIDO
+#define TRAMA_H_INCLUIDO
+
+#include <stdint.h>
+
+const uint8_t ID_TRAMA_V1 = 0xAA;   ///< Cabecera de la trama original (sin secuencia).
+const uint8_t ID_TRAMA_V2 = 0xAB;   ///< Cabecera de la trama con secuencia y tiempo.
+const uint8_t TAM_TRAMA_V1 = 9;     ///< Tamaño mínimo de la trama v1 (sin byte de alarmas).
+const uint8_t TAM_TRAMA_V2 = 17;    ///< Tamaño de la trama v2.
+const uint8_t POS_SECUENCIA_V2 = 2; ///< Posición de la secuencia en la trama v2.
+const uint8_t POS_SEGUNDOS_V2 = 6;  ///< Posición del tiempo desde el arranque en la trama v2.
+
+/**
+ * @struct Medidas
+ * @brief Valores de una trama, ya en las unidades en que viajan.
+ */
+struct Medidas {
+  uint16_t o3ppb = 0;           ///< Ozono (ppb).
+  uint16_t temperaturaX10 = 0;  ///< Temperatura (ºC x10).
+  uint16_t co2ppm = 0;          ///< CO2 (ppm).
+  uint16_t bateria = 0;         ///< Batería (%).
+  uint8_t alarmas = 0;          ///< Máscara de alarmas activas.
+  uint32_t secuencia = 0;       ///< Número de secuencia (0 en tramas v1).
+  uint32_t segundos = 0;        ///< Segundos desde el arranque (0 en tramas v1).
+};
+
+/// @brief Escribe un entero de n bytes en Little Endian.
+inline void escribirLE( uint8_t * p, uint32_t v, int n ) {
+  for ( int i = 0; i < n; i++ ) p[i] = (uint8_t)( v >> ( 8 * i ) );
+}
+
+/// @brief Lee un entero de n bytes en Little Endian.
+inline uint32_t leerLE( const uint8_t * p, int n ) {
+  uint32_t v = 0;
+  for ( int i = n - 1; i >= 0; i-- ) v = ( v << 8 ) | p[i];
+  return v;
+}
+
+/**
+ * @brief Empaqueta unas medidas en una trama v2.
+ * @param datos Destino (TAM_TRAMA_V2 bytes).
+ * @param m Medidas, alarmas, secuencia y tiempo.
+ */
+inline void empaquetarTrama( uint8_t * datos, const Medidas & m ) {
+  datos[0] = ID_TRAMA_V2;
+  datos[1] = m.alarmas;
+  escribirLE( &datos[2], m.secuencia, 4 );
+  escribirLE( &datos[6], m.segundos, 3 );
+  escribirLE( &datos[9], m.o3ppb, 2 );
+  escribirLE( &datos[11], m.temperaturaX10, 2 );
+  escribirLE( &datos[13], m.co2ppm, 2 );
+  escribirLE( &datos[15], m.bateria, 2 );
+}
+
+/**
+ * @brief Lee solo el número de secuencia de una trama (para deduplicar).
+ * @param datos Trama (a partir del ID).
+ * @param tam Bytes disponibles.
+ * @param secuencia Destino.
+ * @return true si es una trama v2.
+ */
+inline bool leerSecuencia( const uint8_t * datos, uint8_t tam, uint32_t & secuencia ) {
+  if ( tam < TAM_TRAMA_V2 || datos[0] != ID_TRAMA_V2 ) return false;
+  secuencia = leerLE( &datos[POS_SECUENCIA_V2], 4 );
+  return true;
+}
+
+/**
+ * @brief Lee el número de secuencia y el tiempo desde el arranque de una trama.
+ * @param datos Trama (a partir del ID).
+ * @param tam Bytes disponibles.
+ * @param secuencia Destino de la secuencia.
+ * @param segundos Destino del tiempo desde el arranque.
+ * @return true si es una trama v2.
+ */
+inline bool leerSecuencia( const uint8_t * datos, uint8_t tam, uint32_t & secuencia, uint32_t & segundos ) {
+  if ( ! leerSecuencia( datos, tam, secuencia ) ) return false;
+  segundos = leerLE( &datos[POS_SEGUNDOS_V2], 3 );
+  return true;
+}
+
+/**
+ * @brief Desempaqueta una trama v1 o v2.
+ * @param datos Trama (a partir del ID).
+ * @param tam Bytes disponibles.
+ * @param m Destino de las medidas.
+ * @return Versión de la trama (1 o 2), o 0 si no es una trama de sensores.
+ */
+inline int desempaquetarTrama( const uint8_t * datos, uint8_t tam, Medidas & m ) {
+  if ( tam >= TAM_TRAMA_V2 && datos[0] == ID_TRAMA_V2 ) {
+    m.alarmas = datos[1];
+    m.secuencia = leerLE( &datos[2], 4 );
+    m.segundos = leerLE( &datos[6], 3 );
+    m.o3ppb = (uint16_t) leerLE( &datos[9], 2 );
+    m.temperaturaX10 = (uint16_t) leerLE( &datos[11], 2 );
+    m.co2ppm = (uint16_t) leerLE( &datos[13], 2 );
+    m.bateria = (uint16_t) leerLE( &datos[15], 2 );
+    return 2;
+  }
+  if ( tam >= TAM_TRAMA_V1 && datos[0] == ID_TRAMA_V1 ) {
+    m.o3ppb = (uint16_t) leerLE( &datos[1], 2 );
+    m.temperaturaX10 = (uint16_t) leerLE( &datos[3], 2 );
+    m.co2ppm = (uint16_t) leerLE( &datos[5], 2 );
+    m.bateria = (uint16_t) leerLE( &datos[7], 2 );
+    m.alarmas = ( tam > TAM_TRAMA_V1 ? datos[9] : 0 );
+    m.secuencia = 0;
+    m.segundos = 0;
+    return 1;
+  }
+  return 0;
+}
+
+#endif
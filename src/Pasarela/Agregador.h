@@ -0,0 +1,356 @@
+/**
+ * @file Agregador.h
+ * @brief Agregación incremental en ventanas deslizantes de la serie decodificada.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Los paneles piden medias de 1 minuto, 1 hora y 8 horas (la ventana
+ * reglamentaria del ozono) y el máximo de CO2 de cada sala. En vez de
+ * recalcularlas desde las muestras, cada dispositivo guarda un estado con
+ * una VentanaDeslizante por magnitud y anchura que se actualiza en O(1) por muestra.
+ *
+ * Cada ventana es un anillo de cubetas (suma, cuenta y máximo) con totales
+ * acumulados: al avanzar el tiempo se restan las cubetas que salen. La
+ * ventana cubre las últimas CUBETAS cubetas, así que su borde tiene la
+ * resolución de una cubeta (5 s, 1 min y 10 min). Las muestras que llegan
+ * tarde pero aún dentro de la ventana entran en su cubeta, por lo que el
+ * resultado no depende del orden en que se procesen.
+ *
+ * Los estados viven en un MapaFragmentado: fragmentos con su propio cerrojo,
+ * elegidos por el hash del dispositivo, para que varios hilos actualicen
+ * dispositivos distintos sin pisarse.
+ */
+
+#ifndef AGREGADOR_H_INCLUIDO
+#define AGREGADOR_H_INCLUIDO
+
+#include "Decodificador.h"
+
+#include <climits>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pasarela {
+
+  /**
+   * @class VentanaDeslizante
+   * @brief Media y máximo de las últimas CUBETAS cubetas de tiempo.
+   * @tparam CUBETAS Número de cubetas del anillo.
+   * @tparam ANCHO_CUBETA_US Anchura de cada cubeta (µs).
+   */
+  template <uint32_t CUBETAS, uint64_t ANCHO_CUBETA_US>
+  class VentanaDeslizante {
+
+  public:
+    /// @brief Anchura total de la ventana (µs).
+    static const uint64_t ANCHO_US = CUBETAS * ANCHO_CUBETA_US;
+
+  private:
+    int64_t sumas[CUBETAS] = {};
+    uint32_t cuentas[CUBETAS] = {};
+    int32_t maximos[CUBETAS];
+    uint64_t cubetaActual = 0;   ///< Índice absoluto (tiempo / ANCHO_CUBETA_US) de la cubeta más reciente.
+    int64_t sumaTotal = 0;
+    uint32_t cuentaTotal = 0;
+
+  public:
+    VentanaDeslizante() {
+      for ( uint32_t i = 0; i < CUBETAS; i++ ) maximos[i] = INT32_MIN;
+    }
+
+    /**
+     * @brief Lleva la ventana hasta el instante indicado, vaciando las cubetas que salen.
+     * @details Como mucho recorre CUBETAS cubetas; repartido entre las muestras, O(1).
+     */
+    void avanzarHasta( uint64_t tiempoUs ) {
+      uint64_t cubeta = tiempoUs / ANCHO_CUBETA_US;
+      if ( cubeta <= cubetaActual ) return;
+      uint64_t pasos = cubeta - cubetaActual;
+      if ( pasos > CUBETAS ) pasos = CUBETAS;
+      for ( uint64_t i = 1; i <= pasos; i++ ) {
+        uint32_t k = (uint32_t)( ( cubetaActual + i ) % CUBETAS );
+        sumaTotal -= sumas[k];
+        cuentaTotal -= cuentas[k];
+        sumas[k] = 0;
+        cuentas[k] = 0;
+        maximos[k] = INT32_MIN;
+      }
+      cubetaActual = cubeta;
+    }
+
+    /**
+     * @brief Añade una muestra.
+     * @return false si es más antigua que la ventana (se descarta).
+     */
+    bool anyadir( uint64_t tiempoUs, int32_t valor ) {
+      avanzarHasta( tiempoUs );
+      uint64_t cubeta = tiempoUs / ANCHO_CUBETA_US;
+      if ( cubeta + CUBETAS <= cubetaActual ) return false;
+      uint32_t k = (uint32_t)( cubeta % CUBETAS );
+      sumas[k] += valor;
+      cuentas[k]++;
+      if ( valor > maximos[k] ) maximos[k] = valor;
+      sumaTotal += valor;
+      cuentaTotal++;
+      return true;
+    }
+
+    /// @brief Muestras dentro de la ventana.
+    uint32_t muestras() const { return cuentaTotal; }
+
+    /// @brief Media de la ventana (NAN si está vacía).
+    double media() const { return cuentaTotal > 0 ? (double) sumaTotal / cuentaTotal : NAN; }
+
+    /// @brief Máximo de la ventana (INT32_MIN si está vacía). Recorre las cubetas.
+    int32_t maximo() const {
+      int32_t m = INT32_MIN;
+      for ( uint32_t i = 0; i < CUBETAS; i++ ) if ( maximos[i] > m ) m = maximos[i];
+      return m;
+    }
+  };
+
+  /// @brief 1 minuto en 12 cubetas de 5 s.
+  typedef VentanaDeslizante<12, 5000000ULL> VentanaMinuto;
+  /// @brief 1 hora en 60 cubetas de 1 min.
+  typedef VentanaDeslizante<60, 60000000ULL> VentanaHora;
+  /// @brief 8 horas en 48 cubetas de 10 min.
+  typedef VentanaDeslizante<48, 600000000ULL> Ventana8Horas;
+
+  /**
+   * @struct VentanasMagnitud
+   * @brief Las tres ventanas de una magnitud.
+   */
+  struct VentanasMagnitud {
+    VentanaMinuto minuto;
+    VentanaHora hora;
+    Ventana8Horas ochoHoras;
+
+    void anyadir( uint64_t tiempoUs, int32_t valor ) {
+      minuto.anyadir( tiempoUs, valor );
+      hora.anyadir( tiempoUs, valor );
+      ochoHoras.anyadir( tiempoUs, valor );
+    }
+
+    void avanzarHasta( uint64_t tiempoUs ) {
+      minuto.avanzarHasta( tiempoUs );
+      hora.avanzarHasta( tiempoUs );
+      ochoHoras.avanzarHasta( tiempoUs );
+    }
+  };
+
+  /**
+   * @struct Resumen
+   * @brief Lo que muestra el panel de un dispositivo.
+   */
+  struct Resumen {
+    uint64_t ultimoUs = 0;            ///< Tiempo de la última muestra.
+    double o3[3] = { NAN, NAN, NAN };          ///< Media de O3 (ppb) en 1 min, 1 h y 8 h (NAN = sin muestras).
+    double co2[3] = { NAN, NAN, NAN };         ///< Media de CO2 (ppm) en 1 min, 1 h y 8 h.
+    double temperatura[3] = { NAN, NAN, NAN }; ///< Media de temperatura (ºC x10) en 1 min, 1 h y 8 h.
+    int32_t co2Maximo[3] = { INT32_MIN, INT32_MIN, INT32_MIN }; ///< Máximo de CO2 en 1 min, 1 h y 8 h.
+  };
+
+  /**
+   * @class EstadoDispositivo
+   * @brief Ventanas de O3, CO2 y temperatura de un dispositivo.
+   */
+  class EstadoDispositivo {
+
+  private:
+    VentanasMagnitud o3;
+    VentanasMagnitud co2;
+    VentanasMagnitud temperatura;
+    uint64_t ultimoUs = 0;
+
+  public:
+    /**
+     * @brief Añade una muestra de la serie (las demás magnitudes se ignoran).
+     */
+    void anyadir( const Muestra & m ) {
+      VentanasMagnitud * v = nullptr;
+      switch ( m.magnitud ) {
+        case O3_PPB: v = &o3; break;
+        case CO2_PPM: v = &co2; break;
+        case TEMPERATURA_X10: v = &temperatura; break;
+        default: return;
+      }
+      v->anyadir( m.tiempoUs, m.valor );
+      if ( m.tiempoUs > ultimoUs ) ultimoUs = m.tiempoUs;
+    }
+
+    /**
+     * @brief Resumen en un instante (p.ej. ahora, para vaciar ventanas de placas calladas).
+     * @param ahoraUs Instante de la consulta (0 = el de la última muestra).
+     */
+    Resumen resumir( uint64_t ahoraUs = 0 ) {
+      uint64_t t = ( ahoraUs > ultimoUs ? ahoraUs : ultimoUs );
+      o3.avanzarHasta( t );
+      co2.avanzarHasta( t );
+      temperatura.avanzarHasta( t );
+
+      Resumen r;
+      r.ultimoUs = ultimoUs;
+      r.o3[0] = o3.minuto.media(); r.o3[1] = o3.hora.media(); r.o3[2] = o3.ochoHoras.media();
+      r.co2[0] = co2.minuto.media(); r.co2[1] = co2.hora.media(); r.co2[2] = co2.ochoHoras.media();
+      r.temperatura[0] = temperatura.minuto.media();
+      r.temperatura[1] = temperatura.hora.media();
+      r.temperatura[2] = temperatura.ochoHoras.media();
+      r.co2Maximo[0] = co2.minuto.maximo(); r.co2Maximo[1] = co2.hora.maximo(); r.co2Maximo[2] = co2.ochoHoras.maximo();
+      return r;
+    }
+  };
+
+  /**
+   * @class MapaFragmentado
+   * @brief Mapa dispositivo -> valor repartido en fragmentos con cerrojo propio.
+   * @tparam Valor Tipo guardado por dispositivo.
+   */
+  template <typename Valor>
+  class MapaFragmentado {
+
+  private:
+    /// @brief Un fragmento, alineado a línea de caché para que los cerrojos no compartan línea.
+    struct alignas( 64 ) Fragmento {
+      std::mutex cerrojo;
+      std::unordered_map<uint64_t, Valor> mapa;
+    };
+
+    std::vector<Fragmento> fragmentos;
+    uint64_t mascara;
+
+    /// @brief Mezcla los bits de la dirección (las de una flota se parecen mucho).
+    static uint64_t mezclar( uint64_t x ) {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdULL;
+      x ^= x >> 33;
+      return x;
+    }
+
+    Fragmento & fragmento( uint64_t clave ) {
+      return fragmentos[ mezclar( clave ) & mascara ];
+    }
+
+  public:
+    /**
+     * @param numFragmentos Fragmentos (se redondea a potencia de 2).
+     */
+    explicit MapaFragmentado( unsigned numFragmentos = 64 ) {
+      unsigned n = 1;
+      while ( n < numFragmentos ) n <<= 1;
+      fragmentos = std::vector<Fragmento>( n );
+      mascara = n - 1;
+    }
+
+    /**
+     * @brief Ejecuta f(valor) con el fragmento bloqueado (crea el valor si no existe).
+     */
+    template <typename F>
+    void actualizar( uint64_t clave, F && f ) {
+      Fragmento & fr = fragmento( clave );
+      std::lock_guard<std::mutex> guarda( fr.cerrojo );
+      f( fr.mapa[clave] );
+    }
+
+    /**
+     * @brief Ejecuta f(valor) con el fragmento bloqueado solo si la clave existe (no crea nada).
+     * @return false si la clave no está.
+     */
+    template <typename F>
+    bool buscar( uint64_t clave, F && f ) {
+      Fragmento & fr = fragmento( clave );
+      std::lock_guard<std::mutex> guarda( fr.cerrojo );
+      auto it = fr.mapa.find( clave );
+      if ( it == fr.mapa.end() ) return false;
+      f( it->second );
+      return true;
+    }
+
+    /**
+     * @brief Ejecuta f(clave, valor) para todos los elementos, fragmento a fragmento.
+     */
+    template <typename F>
+    void recorrer( F && f ) {
+      for ( Fragmento & fr : fragmentos ) {
+        std::lock_guard<std::mutex> guarda( fr.cerrojo );
+        for ( auto & par : fr.mapa ) f( par.first, par.second );
+      }
+    }
+
+    /// @brief Número de elementos.
+    size_t tam() {
+      size_t n = 0;
+      for ( Fragmento & fr : fragmentos ) {
+        std::lock_guard<std::mutex> guarda( fr.cerrojo );
+        n += fr.mapa.size();
+      }
+      return n;
+    }
+  };
+
+  /**
+   * @class AgregadorVentanas
+   * @brief Etapa de agregación a la salida del decodificador.
+   */
+  class AgregadorVentanas {
+
+  private:
+    MapaFragmentado<EstadoDispositivo> estados;
+
+  public:
+    explicit AgregadorVentanas( unsigned numFragmentos = 64 ) : estados( numFragmentos ) {}
+
+    /**
+     * @brief Añade una muestra (se puede llamar desde varios hilos a la vez).
+     */
+    void anyadir( const Muestra & m ) {
+      estados.actualizar( m.dispositivo, [ & ]( EstadoDispositivo & e ) { e.anyadir( m ); } );
+    }
+
+    /**
+     * @brief Añade un lote de muestras repartiéndolo entre varios hilos.
+     * @param hilos Hilos (0 = los núcleos disponibles).
+     */
+    void anyadir( const Muestra * muestras, size_t n, unsigned hilos = 0 ) {
+      if ( hilos == 0 ) hilos = std::max( 1u, std::thread::hardware_concurrency() );
+      if ( hilos == 1 || n < 4096 ) {
+        for ( size_t i = 0; i < n; i++ ) anyadir( muestras[i] );
+        return;
+      }
+      std::vector<std::thread> trabajadores;
+      for ( unsigned h = 0; h < hilos; h++ ) {
+        size_t ini = n * h / hilos, fin = n * ( h + 1 ) / hilos;
+        trabajadores.emplace_back( [ this, muestras, ini, fin ] {
+          for ( size_t i = ini; i < fin; i++ ) anyadir( muestras[i] );
+        } );
+      }
+      for ( std::thread & t : trabajadores ) t.join();
+    }
+
+    /**
+     * @brief Resumen de un dispositivo.
+     * @param ahoraUs Instante de la consulta (0 = el de su última muestra).
+     * @return Resumen vacío si el dispositivo no tiene estado.
+     */
+    Resumen resumir( uint64_t dispositivo, uint64_t ahoraUs = 0 ) {
+      Resumen r;
+      estados.buscar( dispositivo, [ & ]( EstadoDispositivo & e ) { r = e.resumir( ahoraUs ); } );
+      return r;
+    }
+
+    /**
+     * @brief Ejecuta f(dispositivo, resumen) para todos los dispositivos.
+     */
+    template <typename F>
+    void recorrer( F && f, uint64_t ahoraUs = 0 ) {
+      estados.recorrer( [ & ]( uint64_t d, EstadoDispositivo & e ) { f( d, e.resumir( ahoraUs ) ); } );
+    }
+
+    /// @brief Dispositivos con estado.
+    size_t dispositivos() { return estados.tam(); }
+  };
+
+} // namespace pasarela
+
+#endif
@@ -0,0 +1,541 @@
+/**
+ * @file AlmacenSeries.h
+ * @brief Almacén en columnas, solo de añadir, para la serie temporal decodificada.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Guarda meses de muestras de muchas placas en un directorio con un
+ * subdirectorio por dispositivo y un fichero por magnitud:
+ *
+ *     raiz/c0de00000007/o3_ppb.col
+ *
+ * Cada fichero es una sucesión de bloques de hasta MUESTRAS_POR_BLOQUE muestras.
+ * El bloque empieza con una cabecera fija que hace de índice (rango de
+ * tiempos, mínimo, máximo y suma) y sigue con las muestras codificadas:
+ * delta de delta del tiempo y delta del valor, ambos en zigzag + varint.
+ * Con el muestreo de las placas (30 s con decenas de ms de variación) cada
+ * muestra ocupa unos 4 bytes, cabeceras incluidas, frente a los 24 de la salida binaria del decodificador.
+ *
+ * **Cabecera de bloque (TAM_CABECERA_BLOQUE bytes, Little Endian):**
+ * | Bytes 0-3 | Bytes 4-5 | Bytes 6-7 | Bytes 8-15 | Bytes 16-23 | Bytes 24-27 | Bytes 28-31 | Bytes 32-39 |
+ * |:---------:|:---------:|:---------:|:----------:|:-----------:|:-----------:|:-----------:|:-----------:|
+ * | "BLQ1" | Muestras | Bytes datos | Primer tiempo (µs) | Último tiempo (µs) | Mínimo | Máximo | Suma |
+ *
+ * Un bloque a medio escribir (p.ej. por un corte de luz) termina el fichero:
+ * la lectura se detiene en él y, antes de volver a añadir, AlmacenSeries
+ * recorta la columna hasta el final del último bloque completo.
+ *
+ * La lectura proyecta el fichero en memoria (mmap) y recorre las cabeceras
+ * para montar el índice; las consultas saltan los bloques fuera de rango,
+ * responden con la cabecera cuando un bloque cae entero dentro del intervalo
+ * y solo decodifican, sin copiar, los que lo cortan.
+ */
+
+#ifndef ALMACEN_SERIES_H_INCLUIDO
+#define ALMACEN_SERIES_H_INCLUIDO
+
+#include "Decodificador.h"
+
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pasarela {
+
+  /// @brief Muestras máximas por bloque.
+  const uint16_t MUESTRAS_POR_BLOQUE = 1024;
+  /// @brief Bytes de la cabecera de cada bloque.
+  const size_t TAM_CABECERA_BLOQUE = 40;
+  /// @brief Marca de comienzo de bloque.
+  const char MARCA_BLOQUE[4] = { 'B', 'L', 'Q', '1' };
+
+  /**
+   * @brief Codificación de enteros con signo y longitud variable.
+   */
+  namespace varint {
+
+    inline uint64_t zigzag( int64_t v ) { return ( (uint64_t) v << 1 ) ^ (uint64_t)( v >> 63 ); }
+    inline int64_t dezigzag( uint64_t v ) { return (int64_t)( v >> 1 ) ^ -(int64_t)( v & 1 ); }
+
+    inline void escribir( std::vector<uint8_t> & destino, int64_t v ) {
+      uint64_t z = zigzag( v );
+      while ( z >= 0x80 ) {
+        destino.push_back( (uint8_t)( z | 0x80 ) );
+        z >>= 7;
+      }
+      destino.push_back( (uint8_t) z );
+    }
+
+    inline int64_t leer( const uint8_t * & p ) {
+      uint64_t z = 0;
+      int desplazamiento = 0;
+      uint8_t b;
+      do {
+        b = *p++;
+        z |= (uint64_t)( b & 0x7F ) << desplazamiento;
+        desplazamiento += 7;
+      } while ( b & 0x80 );
+      return dezigzag( z );
+    }
+
+  } // namespace varint
+
+  /**
+   * @struct EntradaIndice
+   * @brief Cabecera de un bloque ya leída.
+   */
+  struct EntradaIndice {
+    uint64_t tInicio;        ///< Tiempo de la primera muestra (µs).
+    uint64_t tFin;           ///< Tiempo de la última muestra (µs).
+    int32_t minimo;
+    int32_t maximo;
+    int64_t suma;
+    uint16_t muestras;
+    uint16_t bytesDatos;
+    const uint8_t * datos;   ///< Muestras codificadas (dentro de la proyección).
+  };
+
+  /**
+   * @struct Agregado
+   * @brief Cuenta, suma, mínimo y máximo de un conjunto de muestras.
+   */
+  struct Agregado {
+    uint64_t muestras = 0;
+    int64_t suma = 0;
+    int32_t minimo = INT32_MAX;
+    int32_t maximo = INT32_MIN;
+
+    void anyadir( int32_t v ) {
+      muestras++;
+      suma += v;
+      if ( v < minimo ) minimo = v;
+      if ( v > maximo ) maximo = v;
+    }
+
+    void combinar( const EntradaIndice & e ) {
+      muestras += e.muestras;
+      suma += e.suma;
+      if ( e.minimo < minimo ) minimo = e.minimo;
+      if ( e.maximo > maximo ) maximo = e.maximo;
+    }
+
+    double media() const { return muestras > 0 ? (double) suma / muestras : 0.0; }
+  };
+
+  /**
+   * @class EscritorColumna
+   * @brief Añade muestras de una magnitud de un dispositivo a su fichero.
+   * @details Las muestras se acumulan hasta completar un bloque; volcar()
+   * escribe también un bloque a medias (la lectura los admite de cualquier tamaño).
+   */
+  class EscritorColumna {
+
+  private:
+    std::string ruta;
+    std::vector<uint8_t> datos;
+    EntradaIndice cabecera {};
+    uint64_t tiempoMinimo;     ///< Primer tiempo que se acepta (el de la última muestra + 1).
+    uint64_t tAnterior = 0;
+    int64_t deltaAnterior = 0;
+    int32_t vAnterior = 0;
+    uint64_t bytesEscritos = 0;
+
+    static void escribirLE( uint8_t * p, uint64_t v, int n ) {
+      for ( int i = 0; i < n; i++ ) p[i] = (uint8_t)( v >> ( 8 * i ) );
+    }
+
+  public:
+    /**
+     * @brief Crea el escritor de una columna.
+     * @param ruta_ Fichero .col (se añade al final si ya existe).
+     * @param tiempoMinimo_ Primer tiempo que se acepta (0 si el fichero es nuevo).
+     */
+    EscritorColumna( std::string ruta_, uint64_t tiempoMinimo_ )
+    : ruta( std::move( ruta_ ) ), tiempoMinimo( tiempoMinimo_ )
+    {
+    }
+
+    EscritorColumna( const EscritorColumna & ) = delete;
+    EscritorColumna & operator=( const EscritorColumna & ) = delete;
+
+    /// @brief Vuelca lo pendiente; los errores solo se notifican con volcar() explícito.
+    ~EscritorColumna() {
+      try { volcar(); } catch ( const std::exception & ) {}
+    }
+
+    /**
+     * @brief Añade una muestra.
+     * @param tiempoUs Tiempo (µs).
+     * @param valor Valor de la muestra.
+     * @return false si el tiempo no es posterior al de la última muestra (se descarta).
+     */
+    bool anyadir( uint64_t tiempoUs, int32_t valor ) {
+      if ( tiempoUs < tiempoMinimo ) return false;
+      tiempoMinimo = tiempoUs + 1;
+
+      if ( cabecera.muestras == 0 ) {
+        cabecera.tInicio = tiempoUs;
+        cabecera.minimo = INT32_MAX;
+        cabecera.maximo = INT32_MIN;
+        cabecera.suma = 0;
+        tAnterior = tiempoUs;
+        deltaAnterior = 0;
+        vAnterior = 0;
+      }
+
+      int64_t delta = (int64_t)( tiempoUs - tAnterior );
+      varint::escribir( datos, delta - deltaAnterior );
+      varint::escribir( datos, (int64_t) valor - vAnterior );
+      tAnterior = tiempoUs;
+      deltaAnterior = delta;
+      vAnterior = valor;
+
+      cabecera.tFin = tiempoUs;
+      if ( valor < cabecera.minimo ) cabecera.minimo = valor;
+      if ( valor > cabecera.maximo ) cabecera.maximo = valor;
+      cabecera.suma += valor;
+      if ( ++cabecera.muestras == MUESTRAS_POR_BLOQUE ) volcar();
+      return true;
+    }
+
+    /**
+     * @brief Escribe en disco el bloque en curso (si tiene muestras).
+     * @throws std::runtime_error si no se puede escribir.
+     */
+    void volcar() {
+      if ( cabecera.muestras == 0 ) return;
+      uint8_t c[TAM_CABECERA_BLOQUE];
+      memcpy( c, MARCA_BLOQUE, 4 );
+      escribirLE( c + 4, cabecera.muestras, 2 );
+      escribirLE( c + 6, datos.size(), 2 );
+      escribirLE( c + 8, cabecera.tInicio, 8 );
+      escribirLE( c + 16, cabecera.tFin, 8 );
+      escribirLE( c + 24, (uint32_t) cabecera.minimo, 4 );
+      escribirLE( c + 28, (uint32_t) cabecera.maximo, 4 );
+      escribirLE( c + 32, (uint64_t) cabecera.suma, 8 );
+
+      std::ofstream f( ruta, std::ios::binary | std::ios::app );
+      f.write( (const char *) c, sizeof( c ) );
+      f.write( (const char *) datos.data(), (std::streamsize) datos.size() );
+      if ( ! f ) throw std::runtime_error( "almacen: no se puede escribir " + ruta );
+
+      bytesEscritos += sizeof( c ) + datos.size();
+      datos.clear();
+      cabecera.muestras = 0;
+    }
+
+    /**
+     * @brief Bytes escritos en disco por este escritor.
+     */
+    uint64_t getBytesEscritos() const { return bytesEscritos; }
+  };
+
+  /**
+   * @class ColumnaMapeada
+   * @brief Fichero de una columna proyectado en memoria, con su índice de bloques.
+   */
+  class ColumnaMapeada {
+
+  private:
+    const uint8_t * base = nullptr;
+    size_t tam = 0;
+    size_t tamValido = 0;    ///< Bytes hasta el final del último bloque completo.
+    std::vector<EntradaIndice> elIndice;
+
+    static uint64_t leerLE( const uint8_t * p, int n ) {
+      uint64_t v = 0;
+      for ( int i = n - 1; i >= 0; i-- ) v = ( v << 8 ) | p[i];
+      return v;
+    }
+
+    /**
+     * @brief Decodifica un bloque entero y llama a f(tiempo, valor) por muestra.
+     */
+    template <typename F>
+    static void decodificar( const EntradaIndice & e, F && f ) {
+      const uint8_t * p = e.datos;
+      uint64_t t = e.tInicio;
+      int64_t delta = 0;
+      int64_t v = 0;
+      for ( uint16_t i = 0; i < e.muestras; i++ ) {
+        delta += varint::leer( p );
+        v += varint::leer( p );
+        t += (uint64_t) delta;
+        f( t, (int32_t) v );
+      }
+    }
+
+  public:
+    /**
+     * @brief Proyecta el fichero de una columna y monta su índice.
+     * @param ruta Fichero .col.
+     * @throws std::runtime_error si no se puede abrir o proyectar.
+     */
+    explicit ColumnaMapeada( const std::string & ruta ) {
+      int fd = open( ruta.c_str(), O_RDONLY );
+      if ( fd < 0 ) throw std::runtime_error( "almacen: no se puede abrir " + ruta );
+      struct stat st;
+      fstat( fd, &st );
+      tam = (size_t) st.st_size;
+      if ( tam > 0 ) {
+        void * m = mmap( nullptr, tam, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( m == MAP_FAILED ) {
+          close( fd );
+          throw std::runtime_error( "almacen: no se puede proyectar " + ruta );
+        }
+        base = (const uint8_t *) m;
+        madvise( m, tam, MADV_SEQUENTIAL );
+      }
+      close( fd );
+
+      size_t pos = 0;
+      while ( pos + TAM_CABECERA_BLOQUE <= tam && memcmp( base + pos, MARCA_BLOQUE, 4 ) == 0 ) {
+        const uint8_t * c = base + pos;
+        EntradaIndice e;
+        e.muestras = (uint16_t) leerLE( c + 4, 2 );
+        e.bytesDatos = (uint16_t) leerLE( c + 6, 2 );
+        e.tInicio = leerLE( c + 8, 8 );
+        e.tFin = leerLE( c + 16, 8 );
+        e.minimo = (int32_t) leerLE( c + 24, 4 );
+        e.maximo = (int32_t) leerLE( c + 28, 4 );
+        e.suma = (int64_t) leerLE( c + 32, 8 );
+        e.datos = c + TAM_CABECERA_BLOQUE;
+        if ( pos + TAM_CABECERA_BLOQUE + e.bytesDatos > tam ) break; // bloque cortado
+        elIndice.push_back( e );
+        pos += TAM_CABECERA_BLOQUE + e.bytesDatos;
+      }
+      tamValido = pos;
+    }
+
+    ColumnaMapeada( ColumnaMapeada && o ) noexcept
+    : base( o.base ), tam( o.tam ), tamValido( o.tamValido ), elIndice( std::move( o.elIndice ) )
+    {
+      o.base = nullptr;
+      o.tam = 0;
+    }
+
+    ColumnaMapeada( const ColumnaMapeada & ) = delete;
+    ColumnaMapeada & operator=( const ColumnaMapeada & ) = delete;
+
+    ~ColumnaMapeada() {
+      if ( base != nullptr ) munmap( (void *) base, tam );
+    }
+
+    /**
+     * @brief Índice de bloques, en el orden del fichero (y del tiempo).
+     */
+    const std::vector<EntradaIndice> & indice() const { return elIndice; }
+
+    /**
+     * @brief Bytes del fichero.
+     */
+    size_t bytes() const { return tam; }
+
+    /**
+     * @brief Bytes hasta el final del último bloque completo (lo que sigue es un bloque cortado).
+     */
+    size_t bytesValidos() const { return tamValido; }
+
+    /**
+     * @brief Recorre las muestras de [t0, t1) sin copiarlas.
+     * @param f Función f(tiempoUs, valor).
+     */
+    template <typename F>
+    void recorrer( uint64_t t0, uint64_t t1, F && f ) const {
+      for ( const EntradaIndice & e : elIndice ) {
+        if ( e.tFin < t0 ) continue;
+        if ( e.tInicio >= t1 ) break;
+        if ( e.tInicio >= t0 && e.tFin < t1 ) {
+          decodificar( e, f );
+        } else {
+          decodificar( e, [ & ]( uint64_t t, int32_t v ) { if ( t >= t0 && t < t1 ) f( t, v ); } );
+        }
+      }
+    }
+
+    /**
+     * @brief Cuenta, suma, mínimo y máximo de [t0, t1).
+     * @details Los bloques enteros dentro del intervalo se resuelven con la cabecera.
+     */
+    Agregado agregar( uint64_t t0, uint64_t t1 ) const {
+      Agregado a;
+      for ( const EntradaIndice & e : elIndice ) {
+        if ( e.tFin < t0 ) continue;
+        if ( e.tInicio >= t1 ) break;
+        if ( e.tInicio >= t0 && e.tFin < t1 ) {
+          a.combinar( e );
+        } else {
+          decodificar( e, [ & ]( uint64_t t, int32_t v ) { if ( t >= t0 && t < t1 ) a.anyadir( v ); } );
+        }
+      }
+      return a;
+    }
+
+    /**
+     * @brief Agrega [t0, t1) en intervalos de anchoUs (p.ej. medias horarias).
+     * @return Un Agregado por intervalo (los vacíos tienen 0 muestras).
+     */
+    std::vector<Agregado> agregarPorIntervalos( uint64_t t0, uint64_t t1, uint64_t anchoUs ) const {
+      std::vector<Agregado> intervalos( t1 > t0 ? ( t1 - t0 + anchoUs - 1 ) / anchoUs : 0 );
+      for ( const EntradaIndice & e : elIndice ) {
+        if ( e.tFin < t0 ) continue;
+        if ( e.tInicio >= t1 ) break;
+        if ( e.tInicio >= t0 && e.tFin < t1 && ( e.tInicio - t0 ) / anchoUs == ( e.tFin - t0 ) / anchoUs ) {
+          intervalos[ ( e.tInicio - t0 ) / anchoUs ].combinar( e );
+        } else {
+          decodificar( e, [ & ]( uint64_t t, int32_t v ) {
+            if ( t >= t0 && t < t1 ) intervalos[ ( t - t0 ) / anchoUs ].anyadir( v );
+          } );
+        }
+      }
+      return intervalos;
+    }
+  };
+
+  /**
+   * @class AlmacenSeries
+   * @brief Directorio de columnas: un EscritorColumna por (dispositivo, magnitud).
+   */
+  class AlmacenSeries {
+
+  private:
+    std::filesystem::path raiz;
+    std::unordered_map<uint64_t, std::unique_ptr<EscritorColumna>> escritores;
+    uint64_t descartadas = 0;
+    uint64_t recortados = 0;
+
+    static uint64_t clave( uint64_t dispositivo, uint8_t magnitud ) {
+      return ( dispositivo << 8 ) | magnitud;
+    }
+
+  public:
+    /**
+     * @brief Abre (o crea) un almacén.
+     * @param raiz_ Directorio del almacén.
+     */
+    explicit AlmacenSeries( const std::string & raiz_ ) : raiz( raiz_ ) {
+      std::filesystem::create_directories( raiz );
+    }
+
+    /**
+     * @brief Nombre del subdirectorio de un dispositivo.
+     */
+    static std::string nombreDispositivo( uint64_t dispositivo ) {
+      char b[16];
+      snprintf( b, sizeof( b ), "%012llx", (unsigned long long) dispositivo );
+      return b;
+    }
+
+    /**
+     * @brief Fichero de una columna.
+     */
+    std::string rutaColumna( uint64_t dispositivo, uint8_t magnitud ) const {
+      return ( raiz / nombreDispositivo( dispositivo ) / ( std::string( nombreMagnitud( magnitud ) ) + ".col" ) ).string();
+    }
+
+    /**
+     * @brief Añade una muestra a su columna.
+     * @details Dentro de cada columna los tiempos deben crecer (la serie de
+     * decodificarCaptura() ya sale ordenada): las muestras que no son
+     * posteriores a la última guardada, p.ej. al volver a ingerir una captura, se descartan.
+     * La primera vez que se abre una columna existente se recorta su bloque
+     * cortado, si lo tiene, para que lo nuevo quede a continuación del último completo.
+     * @return false si la muestra se descartó.
+     */
+    bool anyadir( uint64_t dispositivo, uint8_t magnitud, uint64_t tiempoUs, int32_t valor ) {
+      std::unique_ptr<EscritorColumna> & w = escritores[ clave( dispositivo, magnitud ) ];
+      if ( ! w ) {
+        std::filesystem::create_directories( raiz / nombreDispositivo( dispositivo ) );
+        std::string ruta = rutaColumna( dispositivo, magnitud );
+        uint64_t minimo = 0;
+        if ( std::filesystem::exists( ruta ) ) {
+          size_t tam, valido;
+          {
+            ColumnaMapeada previa( ruta );
+            if ( ! previa.indice().empty() ) minimo = previa.indice().back().tFin + 1;
+            tam = previa.bytes();
+            valido = previa.bytesValidos();
+          }
+          if ( valido < tam ) {
+            std::filesystem::resize_file( ruta, valido );
+            recortados += tam - valido;
+          }
+        }
+        w.reset( new EscritorColumna( ruta, minimo ) );
+      }
+      if ( w->anyadir( tiempoUs, valor ) ) return true;
+      descartadas++;
+      return false;
+    }
+
+    bool anyadir( const Muestra & m ) {
+      return anyadir( m.dispositivo, m.magnitud, m.tiempoUs, m.valor );
+    }
+
+    /**
+     * @brief Muestras descartadas por llegar fuera de orden.
+     */
+    uint64_t getDescartadas() const { return descartadas; }
+
+    /**
+     * @brief Bytes de bloques cortados recortados al reabrir columnas.
+     */
+    uint64_t getBytesRecortados() const { return recortados; }
+
+    /**
+     * @brief Bytes escritos en disco desde que se abrió el almacén.
+     */
+    uint64_t getBytesEscritos() const {
+      uint64_t total = 0;
+      for ( const auto & par : escritores ) total += par.second->getBytesEscritos();
+      return total;
+    }
+
+    /**
+     * @brief Escribe los bloques a medias de todas las columnas.
+     */
+    void volcar() {
+      for ( auto & par : escritores ) par.second->volcar();
+    }
+
+    /**
+     * @brief Proyecta una columna para consultarla.
+     * @throws std::runtime_error si no existe.
+     */
+    ColumnaMapeada abrir( uint64_t dispositivo, uint8_t magnitud ) const {
+      return ColumnaMapeada( rutaColumna( dispositivo, magnitud ) );
+    }
+
+    /**
+     * @brief Dispositivos con datos en el almacén.
+     */
+    std::vector<uint64_t> dispositivos() const {
+      std::vector<uint64_t> r;
+      for ( const auto & d : std::filesystem::directory_iterator( raiz ) ) {
+        if ( d.is_directory() ) r.push_back( std::stoull( d.path().filename().string(), nullptr, 16 ) );
+      }
+      std::sort( r.begin(), r.end() );
+      return r;
+    }
+
+    /**
+     * @brief true si existe la columna.
+     */
+    bool existe( uint64_t dispositivo, uint8_t magnitud ) const {
+      return std::filesystem::exists( rutaColumna( dispositivo, magnitud ) );
+    }
+  };
+
+} // namespace pasarela
+
+#endif
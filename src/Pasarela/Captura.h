@@ -0,0 +1,339 @@
+/**
+ * @file Captura.h
+ * @brief Lectura y escritura de capturas de anuncios BLE en el ordenador.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Admite dos formatos:
+ * - **btsnoop** (el que guardan Android, Wireshark o btmon): se extraen los
+ *   eventos HCI LE Advertising Report y LE Extended Advertising Report. Los
+ *   informes que no se pueden leer enteros se descartan (ver
+ *   informesDescartados()).
+ * - **GTICAP** (formato simple propio), un registro por anuncio recibido:
+ *
+ * | Bytes 0-7 | Bytes 8-13 | Byte 14 | Byte 15 | Bytes 16.. |
+ * |:---------:|:----------:|:-------:|:-------:|:----------:|
+ * | Tiempo (µs, LE) | Dirección (LE) | RSSI | Longitud | Datos AD |
+ *
+ * precedidos por la cabecera de 8 bytes "GTICAP1\0".
+ *
+ * La captura se carga entera en memoria y cada TramaCapturada apunta dentro
+ * de ese búfer, de modo que el índice de tramas no copia ningún dato.
+ */
+
+#ifndef CAPTURA_H_INCLUIDO
+#define CAPTURA_H_INCLUIDO
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pasarela {
+
+  /// @brief Cabecera del formato de captura simple.
+  const char CABECERA_GTICAP[8] = { 'G', 'T', 'I', 'C', 'A', 'P', '1', '\0' };
+  /// @brief Cabecera de los ficheros btsnoop.
+  const char CABECERA_BTSNOOP[8] = { 'b', 't', 's', 'n', 'o', 'o', 'p', '\0' };
+  /// @brief Diferencia entre el origen de tiempos de btsnoop (año 0) y el de Unix (µs).
+  const uint64_t EPOCA_BTSNOOP_US = 0x00dcddb30f2f8000ULL;
+
+  /**
+   * @struct TramaCapturada
+   * @brief Un anuncio recibido: cuándo, de quién y con qué datos AD.
+   */
+  struct TramaCapturada {
+    uint64_t tiempoUs;       ///< Marca de tiempo (µs).
+    uint64_t dispositivo;    ///< Dirección BLE (48 bits).
+    const uint8_t * datos;   ///< Estructuras AD (apunta al búfer de la captura).
+    uint16_t longitud;       ///< Bytes de datos AD.
+    int8_t rssi;             ///< RSSI (dBm).
+  };
+
+  /**
+   * @class Captura
+   * @brief Contenido de un fichero de captura y su índice de tramas.
+   */
+  class Captura {
+
+  private:
+    std::vector<uint8_t> bufer;
+    std::vector<TramaCapturada> lasTramas;
+    size_t descartados = 0;
+    /// @brief Anunciantes (dirección y SID) con un anuncio extendido fragmentado en curso.
+    std::vector<uint64_t> fragmentados;
+
+    static uint32_t leerBE32( const uint8_t * p ) {
+      return ( (uint32_t) p[0] << 24 ) | ( (uint32_t) p[1] << 16 ) | ( (uint32_t) p[2] << 8 ) | p[3];
+    }
+    static uint64_t leerBE64( const uint8_t * p ) {
+      return ( (uint64_t) leerBE32( p ) << 32 ) | leerBE32( p + 4 );
+    }
+    static uint64_t leerLE( const uint8_t * p, int n ) {
+      uint64_t v = 0;
+      for ( int i = n - 1; i >= 0; i-- ) v = ( v << 8 ) | p[i];
+      return v;
+    }
+
+    /**
+     * @brief Indexa un búfer en formato GTICAP.
+     */
+    void indexarGticap() {
+      size_t pos = sizeof( CABECERA_GTICAP );
+      while ( pos + 16 <= bufer.size() ) {
+        const uint8_t * r = &bufer[pos];
+        uint8_t len = r[15];
+        if ( pos + 16 + len > bufer.size() ) break; // registro truncado
+        lasTramas.push_back( { leerLE( r, 8 ), leerLE( r + 8, 6 ), r + 16, len, (int8_t) r[14] } );
+        pos += 16 + len;
+      }
+    }
+
+    /**
+     * @brief Extrae los informes de un evento LE Advertising Report.
+     * @details La especificación agrupa cada campo en un array con un elemento
+     * por informe: todos los tipos, todos los tipos de dirección, todas las
+     * direcciones, todas las longitudes, todos los datos y todos los RSSI. Si
+     * las longitudes no cuadran con el tamaño del evento se descarta entero.
+     */
+    void extraerInformesLegados( const uint8_t * p, const uint8_t * fin, uint8_t numInformes, uint64_t tiempoUs ) {
+      const size_t n = numInformes;
+      const uint8_t * direcciones = p + 2 * n;
+      const uint8_t * longitudes = direcciones + 6 * n;
+      const uint8_t * datos = longitudes + n;
+      if ( datos > fin ) { descartados += n; return; }
+      size_t total = 0;
+      for ( size_t i = 0; i < n; i++ ) total += longitudes[i];
+      const uint8_t * rssi = datos + total;
+      if ( rssi + n > fin ) { descartados += n; return; }
+
+      for ( size_t i = 0; i < n; i++ ) {
+        lasTramas.push_back( { tiempoUs, leerLE( direcciones + 6 * i, 6 ), datos, longitudes[i], (int8_t) rssi[i] } );
+        datos += longitudes[i];
+      }
+    }
+
+    /**
+     * @brief Extrae los informes de un evento LE Extended Advertising Report.
+     * @details Los informes van uno detrás de otro. Un anuncio de más de lo que
+     * cabe en un evento llega en varios informes (Data Status = 1 en todos
+     * menos el último); esos fragmentos, y los de un anuncio truncado (Data
+     * Status = 2), se descartan: las tramas de los nodos caben en un anuncio
+     * clásico y nunca llegan fragmentadas.
+     */
+    void extraerInformesExtendidos( const uint8_t * p, const uint8_t * fin, uint8_t numInformes, uint64_t tiempoUs ) {
+      for ( int i = 0; i < numInformes; i++ ) {
+        if ( p + 24 > fin ) { descartados += numInformes - i; return; }
+        const uint8_t lenDatos = p[23];
+        if ( p + 24 + lenDatos > fin ) { descartados += numInformes - i; return; }
+
+        const uint8_t estado = ( p[0] >> 5 ) & 0x03;
+        const uint64_t direccion = leerLE( p + 3, 6 );
+        const uint64_t anunciante = ( direccion << 8 ) | p[11];
+        auto enCurso = std::find( fragmentados.begin(), fragmentados.end(), anunciante );
+        const bool continuacion = ( enCurso != fragmentados.end() );
+        if ( estado == 1 ) {
+          if ( ! continuacion ) fragmentados.push_back( anunciante );
+        } else if ( continuacion ) {
+          fragmentados.erase( enCurso );
+        }
+
+        if ( estado == 0 && ! continuacion ) {
+          lasTramas.push_back( { tiempoUs, direccion, p + 24, lenDatos, (int8_t) p[13] } );
+        } else {
+          descartados++;
+        }
+        p += 24 + lenDatos;
+      }
+    }
+
+    /**
+     * @brief Extrae los anuncios de un evento HCI LE Meta.
+     * @param ev Parámetros del evento (a partir del subevento).
+     * @param len Longitud de los parámetros.
+     * @param tiempoUs Marca de tiempo del registro.
+     */
+    void extraerInformesLE( const uint8_t * ev, size_t len, uint64_t tiempoUs ) {
+      if ( len < 2 ) return;
+      const uint8_t subevento = ev[0];
+      const uint8_t numInformes = ev[1];
+      if ( subevento == 0x02 ) {
+        extraerInformesLegados( ev + 2, ev + len, numInformes, tiempoUs );
+      } else if ( subevento == 0x0D ) {
+        extraerInformesExtendidos( ev + 2, ev + len, numInformes, tiempoUs );
+      }
+    }
+
+    /**
+     * @brief Indexa un búfer en formato btsnoop (enlaces 1001 y 1002).
+     */
+    void indexarBtsnoop() {
+      if ( bufer.size() < 16 ) return;
+      const uint32_t enlace = leerBE32( &bufer[12] );
+      if ( enlace != 1001 && enlace != 1002 ) {
+        throw std::runtime_error( "btsnoop: tipo de enlace no soportado" );
+      }
+      size_t pos = 16;
+      while ( pos + 24 <= bufer.size() ) {
+        const uint8_t * r = &bufer[pos];
+        const uint32_t incluido = leerBE32( r + 4 );
+        const uint32_t banderas = leerBE32( r + 8 );
+        const uint64_t tiempoUs = leerBE64( r + 16 ) - EPOCA_BTSNOOP_US;
+        if ( pos + 24 + incluido > bufer.size() ) break;
+        const uint8_t * paquete = r + 24;
+        size_t len = incluido;
+
+        bool esEvento;
+        if ( enlace == 1002 ) {
+          esEvento = ( len > 0 && paquete[0] == 0x04 );
+          paquete++; len = ( len > 0 ? len - 1 : 0 );
+        } else {
+          esEvento = ( banderas & 0x03 ) == 0x03; // recibido + comando/evento
+        }
+        // Evento LE Meta (0x3E)
+        if ( esEvento && len >= 2 && paquete[0] == 0x3E ) {
+          size_t lenParam = paquete[1];
+          if ( lenParam + 2 <= len ) extraerInformesLE( paquete + 2, lenParam, tiempoUs );
+        }
+        pos += 24 + incluido;
+      }
+    }
+
+  public:
+
+    /**
+     * @brief Crea una captura a partir de un búfer ya cargado.
+     * @param contenido Bytes del fichero (se toma su propiedad).
+     * @throws std::runtime_error si el formato no se reconoce.
+     */
+    explicit Captura( std::vector<uint8_t> contenido )
+    : bufer( std::move( contenido ) )
+    {
+      if ( bufer.size() >= 8 && memcmp( bufer.data(), CABECERA_GTICAP, 8 ) == 0 ) {
+        indexarGticap();
+      } else if ( bufer.size() >= 8 && memcmp( bufer.data(), CABECERA_BTSNOOP, 8 ) == 0 ) {
+        indexarBtsnoop();
+      } else {
+        throw std::runtime_error( "formato de captura desconocido" );
+      }
+    }
+
+    /**
+     * @brief Carga una captura desde disco.
+     * @param ruta Fichero btsnoop o GTICAP.
+     * @return La captura indexada.
+     * @throws std::runtime_error si no se puede leer o el formato no se reconoce.
+     */
+    static Captura cargar( const std::string & ruta ) {
+      std::ifstream f( ruta, std::ios::binary );
+      if ( ! f ) throw std::runtime_error( "no se puede abrir " + ruta );
+      std::vector<uint8_t> contenido( ( std::istreambuf_iterator<char>( f ) ),
+                                      std::istreambuf_iterator<char>() );
+      return Captura( std::move( contenido ) );
+    }
+
+    /**
+     * @brief Tramas de la captura, en el orden del fichero.
+     */
+    const std::vector<TramaCapturada> & tramas() const {
+      return lasTramas;
+    }
+
+    /**
+     * @brief Informes que no se leen: eventos mal formados y anuncios extendidos fragmentados o truncados.
+     */
+    size_t informesDescartados() const {
+      return descartados;
+    }
+
+  }; // class
+
+  /**
+   * @class EscritorCaptura
+   * @brief Genera capturas en formato GTICAP (p.ej. desde los simuladores).
+   * @details Sin destino, la captura se acumula en memoria; con destino, se
+   * vuelca a él por bloques para poder generar capturas de muchos GB.
+   */
+  class EscritorCaptura {
+
+  private:
+    /// @brief Tamaño de búfer a partir del que se vuelca al destino.
+    static const size_t TAM_BLOQUE = 1 << 20;
+
+    std::vector<uint8_t> bufer;
+    std::ostream * destino = nullptr;
+
+  public:
+    EscritorCaptura() {
+      bufer.insert( bufer.end(), CABECERA_GTICAP, CABECERA_GTICAP + 8 );
+    }
+
+    /**
+     * @brief Crea un escritor que vuelca la captura a un flujo.
+     * @param destino_ Flujo de salida (debe seguir vivo hasta terminar()).
+     */
+    explicit EscritorCaptura( std::ostream & destino_ )
+    : EscritorCaptura()
+    {
+      destino = &destino_;
+    }
+
+    /**
+     * @brief Vuelca al destino lo que quede en el búfer.
+     */
+    void terminar() {
+      if ( destino == nullptr ) return;
+      destino->write( (const char *) bufer.data(), (std::streamsize) bufer.size() );
+      destino->flush();
+      bufer.clear();
+    }
+
+    /**
+     * @brief Añade un anuncio recibido.
+     * @param tiempoUs Marca de tiempo (µs).
+     * @param dispositivo Dirección BLE (48 bits).
+     * @param rssi RSSI (dBm).
+     * @param datos Estructuras AD.
+     * @param len Bytes de datos AD (máximo 255).
+     */
+    void anyadir( uint64_t tiempoUs, uint64_t dispositivo, int8_t rssi,
+                  const uint8_t * datos, uint8_t len ) {
+      uint8_t cabecera[16];
+      for ( int i = 0; i < 8; i++ ) cabecera[i] = (uint8_t)( tiempoUs >> ( 8 * i ) );
+      for ( int i = 0; i < 6; i++ ) cabecera[8 + i] = (uint8_t)( dispositivo >> ( 8 * i ) );
+      cabecera[14] = (uint8_t) rssi;
+      cabecera[15] = len;
+      bufer.insert( bufer.end(), cabecera, cabecera + 16 );
+      bufer.insert( bufer.end(), datos, datos + len );
+      if ( destino != nullptr && bufer.size() >= TAM_BLOQUE ) terminar();
+    }
+
+    /**
+     * @brief Bytes de la captura generada hasta ahora.
+     */
+    const std::vector<uint8_t> & contenido() const { return bufer; }
+
+    /**
+     * @brief Se queda con los bytes generados (el escritor queda vacío).
+     */
+    std::vector<uint8_t> extraer() { return std::move( bufer ); }
+
+    /**
+     * @brief Guarda la captura en disco.
+     * @param ruta Fichero de destino.
+     * @return true si se escribió correctamente.
+     */
+    bool guardar( const std::string & ruta ) const {
+      std::ofstream f( ruta, std::ios::binary );
+      f.write( (const char *) bufer.data(), (std::streamsize) bufer.size() );
+      return (bool) f;
+    }
+
+  }; // class
+
+} // namespace pasarela
+
+#endif
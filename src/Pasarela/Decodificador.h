@@ -0,0 +1,310 @@
+/**
+ * @file Decodificador.h
+ * @brief Decodificación en paralelo de los anuncios de las placas.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Entiende las tramas que emite el firmware:
+ * - El payload propio de EmisoraBLE::emitirDatosMultiples() tras el
+ *   fabricante 0x004c, en sus versiones v1 (0xAA) y v2 (0xAB, con secuencia
+ *   y tiempo), ver Trama.h.
+ * - Los iBeacon de Publicador: major = (MedicionesID << 8) | contador y
+ *   minor = valor de la medida.
+ *
+ * Cada anuncio se repite muchas veces mientras dura el ciclo, así que las
+ * repeticiones se descartan por dispositivo: por número de secuencia en las
+ * tramas v2 (IndiceDuplicados), por contador en los iBeacon y por contenido
+ * en las tramas v1. El resultado es una serie temporal compacta de Muestra.
+ */
+
+#ifndef DECODIFICADOR_H_INCLUIDO
+#define DECODIFICADOR_H_INCLUIDO
+
+#include "Captura.h"
+#include "IndiceDuplicados.h"
+#include "../HolaMundoIBeacon/Trama.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+namespace pasarela {
+
+  /// @brief Company ID con el que emiten las placas (Apple, como los iBeacon).
+  const uint16_t FABRICANTE_PLACAS = 0x004c;
+  /// @brief UUID de los iBeacon de Publicador.
+  const uint8_t UUID_PUBLICADOR[16] = {
+    'E', 'P', 'S', 'G', '-', 'G', 'T', 'I', '-', 'P', 'R', 'O', 'Y', '-', '3', 'A'
+  };
+
+  /**
+   * @brief Magnitud de cada muestra de la serie temporal.
+   */
+  enum Magnitud : uint8_t {
+    O3_PPB = 1,          ///< Ozono (ppb).
+    TEMPERATURA_X10 = 2, ///< Temperatura (ºC x10).
+    CO2_PPM = 3,         ///< CO2 (ppm).
+    BATERIA = 4,         ///< Batería (%).
+    RUIDO = 5            ///< Ruido (iBeacon RUIDO).
+  };
+
+  /**
+   * @brief Nombre de una magnitud (para la salida CSV).
+   */
+  inline const char * nombreMagnitud( uint8_t m ) {
+    switch ( m ) {
+      case O3_PPB: return "o3_ppb";
+      case TEMPERATURA_X10: return "temp_x10";
+      case CO2_PPM: return "co2_ppm";
+      case BATERIA: return "bateria";
+      case RUIDO: return "ruido";
+    }
+    return "?";
+  }
+
+  /**
+   * @struct Muestra
+   * @brief Un valor decodificado: elemento de la serie temporal.
+   */
+  struct Muestra {
+    uint64_t tiempoUs;      ///< Momento de la primera recepción.
+    uint64_t dispositivo;   ///< Dirección BLE de la placa.
+    int32_t valor;          ///< Valor en las unidades de la magnitud.
+    uint32_t secuencia;     ///< Secuencia de la trama (0 si no la lleva).
+    uint8_t magnitud;       ///< Una de Magnitud.
+    uint8_t alarmas;        ///< Máscara de alarmas del anuncio (0 si no la lleva).
+  };
+
+  /**
+   * @struct Huella
+   * @brief Identifica un anuncio para descartar sus repeticiones.
+   */
+  struct Huella {
+    uint8_t tipo = 0;       ///< 0 = nada que decodificar, 1 = trama v1, 2 = iBeacon, 3 = trama v2.
+    uint8_t canal = 0;      ///< iBeacon: MedicionesID (cada una lleva su contador).
+    uint64_t clave = 0;     ///< Contador (iBeacon), contenido (v1) o secuencia (v2).
+    uint32_t segundos = 0;  ///< Tiempo desde el arranque (v2), para ver los reinicios.
+  };
+
+  /**
+   * @brief Busca los datos de fabricante de las placas dentro de las estructuras AD.
+   * @param ad Estructuras AD.
+   * @param len Longitud total.
+   * @param tam Devuelve la longitud de los datos tras el company ID.
+   * @return Puntero al primer byte tras el company ID, o nullptr.
+   */
+  inline const uint8_t * buscarDatosFabricante( const uint8_t * ad, uint16_t len, uint8_t & tam ) {
+    uint16_t i = 0;
+    while ( i + 1 < len ) {
+      uint8_t lenAD = ad[i];
+      if ( lenAD == 0 || i + 1 + lenAD > len ) break;
+      if ( ad[i + 1] == 0xFF && lenAD >= 3
+           && ( ad[i + 2] | ( ad[i + 3] << 8 ) ) == FABRICANTE_PLACAS ) {
+        tam = (uint8_t)( lenAD - 3 );
+        return &ad[i + 4];
+      }
+      i += lenAD + 1;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Indica si unos datos de fabricante son un iBeacon de Publicador.
+   */
+  inline bool esIBeaconPublicador( const uint8_t * p, uint8_t tam ) {
+    return tam >= 23 && p[0] == 0x02 && p[1] == 0x15 && memcmp( &p[2], UUID_PUBLICADOR, 16 ) == 0;
+  }
+
+  /**
+   * @brief Calcula la huella de una trama sin decodificar sus valores.
+   * @details Es lo único que hace falta para descartar repeticiones.
+   * @param trama Anuncio capturado.
+   * @return Huella (tipo 0 si la trama no es de una placa).
+   */
+  inline Huella calcularHuella( const TramaCapturada & trama ) {
+    Huella h;
+    uint8_t tam = 0;
+    const uint8_t * p = buscarDatosFabricante( trama.datos, trama.longitud, tam );
+    if ( p == nullptr || tam < 1 ) return h;
+
+    uint32_t secuencia;
+    if ( leerSecuencia( p, tam, secuencia, h.segundos ) ) {
+      h.tipo = 3;
+      h.clave = secuencia;
+    } else if ( p[0] == ID_TRAMA_V1 && tam >= TAM_TRAMA_V1 ) {
+      h.tipo = 1;
+      uint64_t clave = 0;
+      for ( int i = 1; i < 9; i++ ) clave = ( clave << 8 ) | p[i];
+      h.clave = clave ^ ( (uint64_t)( tam >= 10 ? p[9] : 0 ) << 56 );
+    } else if ( esIBeaconPublicador( p, tam ) ) {
+      uint8_t id = p[18];
+      if ( id < 11 || id > 13 ) return h;
+      h.tipo = 2;
+      h.canal = id;
+      h.clave = p[19];
+    }
+    return h;
+  }
+
+  /**
+   * @brief Extrae las muestras de una trama de una placa.
+   * @param trama Anuncio capturado.
+   * @param salida Serie a la que se añaden las muestras.
+   */
+  inline void extraerMuestras( const TramaCapturada & trama, std::vector<Muestra> & salida ) {
+    uint8_t tam = 0;
+    const uint8_t * p = buscarDatosFabricante( trama.datos, trama.longitud, tam );
+    if ( p == nullptr || tam < 1 ) return;
+
+    auto anyadir = [ & ]( uint8_t magnitud, int32_t valor, uint8_t alarmas, uint32_t secuencia ) {
+      salida.push_back( { trama.tiempoUs, trama.dispositivo, valor, secuencia, magnitud, alarmas } );
+    };
+
+    Medidas m;
+    if ( desempaquetarTrama( p, tam, m ) != 0 ) {
+      anyadir( O3_PPB, m.o3ppb, m.alarmas, m.secuencia );
+      anyadir( TEMPERATURA_X10, (int16_t) m.temperaturaX10, m.alarmas, m.secuencia );
+      anyadir( CO2_PPM, m.co2ppm, m.alarmas, m.secuencia );
+      anyadir( BATERIA, m.bateria, m.alarmas, m.secuencia );
+    } else if ( esIBeaconPublicador( p, tam ) ) {
+      uint8_t id = p[18];
+      int16_t minor = (int16_t)( ( p[20] << 8 ) | p[21] );
+      uint8_t magnitud = ( id == 11 ? CO2_PPM : id == 12 ? TEMPERATURA_X10 : RUIDO );
+      anyadir( magnitud, minor, 0, p[19] );
+    }
+  }
+
+  /**
+   * @class Deduplicador
+   * @brief Recuerda el último anuncio de cada dispositivo para descartar repeticiones.
+   */
+  class Deduplicador {
+  private:
+    struct Estado {
+      uint64_t ultimoPayload = UINT64_MAX;
+      int16_t ultimoContador[3] = { -1, -1, -1 }; ///< Por MedicionesID 11, 12 y 13.
+    };
+    std::unordered_map<uint64_t, Estado> estados;
+    IndiceDuplicados indice;
+
+  public:
+    /**
+     * @brief Indica si una trama es nueva y la registra.
+     * @param dispositivo Dirección de la placa.
+     * @param h Huella de la trama.
+     * @return true si no es repetición de la anterior del mismo dispositivo.
+     */
+    bool esNueva( uint64_t dispositivo, const Huella & h ) {
+      if ( h.tipo == 3 ) return indice.esNueva( dispositivo, (uint32_t) h.clave, h.segundos );
+
+      Estado & e = estados[ dispositivo ];
+      if ( h.tipo == 1 ) {
+        if ( e.ultimoPayload == h.clave ) return false;
+        e.ultimoPayload = h.clave;
+        return true;
+      }
+      int16_t & ultimo = e.ultimoContador[ ( h.canal - 11 ) % 3 ];
+      if ( ultimo == (int16_t) h.clave ) return false;
+      ultimo = (int16_t) h.clave;
+      return true;
+    }
+  };
+
+  /**
+   * @struct Estadisticas
+   * @brief Contadores de una decodificación.
+   */
+  struct Estadisticas {
+    size_t tramas = 0;        ///< Tramas de la captura.
+    size_t dePlacas = 0;      ///< Tramas reconocidas como de una placa.
+    size_t repetidas = 0;     ///< Tramas descartadas por repetidas.
+    size_t muestras = 0;      ///< Muestras en la serie final.
+  };
+
+  /**
+   * @brief Decodifica una captura completa repartiendo el trabajo entre varios hilos.
+   * @details Fase 1: cada hilo calcula la huella de un tramo contiguo de tramas
+   * y las reparte por dispositivo (dispositivo % hilos). Fase 2: cada hilo
+   * deduplica los dispositivos que le tocan recorriendo sus tramas en orden,
+   * sin cerrojos, y solo decodifica los valores de las tramas nuevas.
+   * Fase 3: se juntan las series y se ordenan por tiempo.
+   * @param captura Captura a decodificar.
+   * @param hilos Número de hilos (0 = todos los núcleos).
+   * @param estadisticas Si no es nullptr, recibe los contadores.
+   * @return Serie temporal ordenada por tiempo.
+   */
+  inline std::vector<Muestra> decodificarCaptura( const Captura & captura, unsigned hilos = 0,
+                                                  Estadisticas * estadisticas = nullptr ) {
+    const std::vector<TramaCapturada> & tramas = captura.tramas();
+    if ( hilos == 0 ) hilos = std::max( 1u, std::thread::hardware_concurrency() );
+    hilos = (unsigned) std::max<size_t>( 1, std::min<size_t>( hilos, tramas.size() ) );
+
+    // --- Fase 1: huellas y reparto por dispositivo ---
+    std::vector<Huella> huellas( tramas.size() );
+    // reparto[h][d]: índices (en orden) del tramo h cuyo dispositivo toca al hilo d
+    std::vector<std::vector<std::vector<uint32_t>>> reparto( hilos, std::vector<std::vector<uint32_t>>( hilos ) );
+    {
+      std::vector<std::thread> trabajadores;
+      const size_t porHilo = ( tramas.size() + hilos - 1 ) / hilos;
+      for ( unsigned h = 0; h < hilos; h++ ) {
+        trabajadores.emplace_back( [ &, h ]() {
+          size_t ini = std::min( tramas.size(), h * porHilo );
+          size_t fin = std::min( tramas.size(), ini + porHilo );
+          for ( size_t i = ini; i < fin; i++ ) {
+            huellas[i] = calcularHuella( tramas[i] );
+            if ( huellas[i].tipo != 0 ) {
+              reparto[h][ tramas[i].dispositivo % hilos ].push_back( (uint32_t) i );
+            }
+          }
+        } );
+      }
+      for ( auto & t : trabajadores ) t.join();
+    }
+
+    // --- Fase 2: deduplicación y decodificación de las tramas nuevas ---
+    std::vector<std::vector<Muestra>> parciales( hilos );
+    std::vector<size_t> repetidas( hilos, 0 ), dePlacas( hilos, 0 );
+    {
+      std::vector<std::thread> trabajadores;
+      for ( unsigned d = 0; d < hilos; d++ ) {
+        trabajadores.emplace_back( [ &, d ]() {
+          Deduplicador dedup;
+          for ( unsigned h = 0; h < hilos; h++ ) {
+            for ( uint32_t i : reparto[h][d] ) {
+              dePlacas[d]++;
+              if ( ! dedup.esNueva( tramas[i].dispositivo, huellas[i] ) ) {
+                repetidas[d]++;
+                continue;
+              }
+              extraerMuestras( tramas[i], parciales[d] );
+            }
+          }
+        } );
+      }
+      for ( auto & t : trabajadores ) t.join();
+    }
+
+    // --- Fase 3: unión ordenada por tiempo ---
+    std::vector<Muestra> serie;
+    size_t total = 0;
+    for ( auto & p : parciales ) total += p.size();
+    serie.reserve( total );
+    for ( auto & p : parciales ) serie.insert( serie.end(), p.begin(), p.end() );
+    std::stable_sort( serie.begin(), serie.end(), []( const Muestra & a, const Muestra & b ) {
+      return a.tiempoUs != b.tiempoUs ? a.tiempoUs < b.tiempoUs : a.dispositivo < b.dispositivo;
+    } );
+
+    if ( estadisticas != nullptr ) {
+      *estadisticas = Estadisticas();
+      estadisticas->tramas = tramas.size();
+      for ( unsigned h = 0; h < hilos; h++ ) {
+        estadisticas->dePlacas += dePlacas[h];
+        estadisticas->repetidas += repetidas[h];
+      }
+      estadisticas->muestras = serie.size();
+    }
+    return serie;
+  }
+
+} // namespace pasarela
+
+#endif
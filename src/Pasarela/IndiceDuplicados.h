@@ -0,0 +1,140 @@
+/**
+ * @file IndiceDuplicados.h
+ * @brief Índice de números de secuencia ya vistos, por dispositivo.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cada placa repite su trama unas 480 veces por ciclo. Con el número
+ * de secuencia de la trama v2, decidir si una copia es repetida es una
+ * consulta O(1) a una ventana deslizante de bits: el bit i indica si ya se
+ * recibió la secuencia (maxima - i). La memoria por dispositivo es fija
+ * (VentanaSecuencias::BITS / 8 bytes más la cabecera), pase lo que pase.
+ *
+ * Al reiniciarse, la placa vuelve a numerar desde 1 y su tiempo desde el
+ * arranque vuelve a empezar. La secuencia sola no basta para verlo (las
+ * tramas 1, 2, 3... de después del reinicio parecen copias viejas), así que
+ * la ventana recuerda también el tiempo de la trama máxima: una trama que no
+ * es más nueva que ella y dice llevar menos tiempo encendida solo puede ser
+ * de un arranque posterior.
+ */
+
+#ifndef INDICE_DUPLICADOS_H_INCLUIDO
+#define INDICE_DUPLICADOS_H_INCLUIDO
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace pasarela {
+
+  /**
+   * @class VentanaSecuencias
+   * @brief Ventana deslizante de las últimas BITS secuencias de un dispositivo.
+   */
+  class VentanaSecuencias {
+
+  public:
+    /// @brief Tamaño de la ventana (potencia de 2).
+    static const uint32_t BITS = 1024;
+
+  private:
+    static const uint32_t PALABRAS = BITS / 64;
+
+    uint64_t bits[PALABRAS];   ///< Bit (secuencia % BITS) = ya recibida.
+    uint32_t maxima = 0;       ///< Mayor secuencia recibida.
+    uint32_t segundosMaxima = 0; ///< Tiempo desde el arranque de la trama máxima.
+    bool vacia = true;
+
+    void poner( uint32_t s ) { bits[ ( s % BITS ) / 64 ] |= 1ULL << ( s % 64 ); }
+    bool esta( uint32_t s ) const { return ( bits[ ( s % BITS ) / 64 ] >> ( s % 64 ) ) & 1; }
+    void quitar( uint32_t s ) { bits[ ( s % BITS ) / 64 ] &= ~( 1ULL << ( s % 64 ) ); }
+
+    void reiniciar( uint32_t s, uint32_t segundos ) {
+      memset( bits, 0, sizeof( bits ) );
+      maxima = s;
+      segundosMaxima = segundos;
+      vacia = false;
+      poner( s );
+    }
+
+    /**
+     * @brief Marca una secuencia en una ventana no vacía, sin mirar el tiempo.
+     * @details Solo detecta el reinicio si la secuencia queda por detrás de la ventana.
+     * @return true si es la primera vez que se ve.
+     */
+    bool marcarSecuencia( uint32_t s ) {
+      if ( s > maxima ) {
+        uint32_t avance = s - maxima;
+        if ( avance >= BITS ) {
+          memset( bits, 0, sizeof( bits ) );
+        } else {
+          // Liberar los huecos de las secuencias que salen de la ventana
+          for ( uint32_t i = maxima + 1; i != s; i++ ) quitar( i );
+        }
+        maxima = s;
+        poner( s );
+        return true;
+      }
+      if ( maxima - s < BITS ) {
+        if ( esta( s ) ) return false;
+        poner( s );
+        return true;
+      }
+      reiniciar( s, segundosMaxima );
+      return true;
+    }
+
+  public:
+    VentanaSecuencias() {
+      memset( bits, 0, sizeof( bits ) );
+    }
+
+    /**
+     * @brief Comprueba si una secuencia es nueva y la marca como vista.
+     * @details Hay reinicio de la placa (y la ventana vuelve a empezar desde
+     * esta trama) si la secuencia no avanza pero el tiempo desde el arranque
+     * retrocede, o si la secuencia queda por detrás de la ventana.
+     * @param s Número de secuencia recibido.
+     * @param segundos Tiempo desde el arranque de la trama.
+     * @return true si es la primera vez que se ve.
+     */
+    bool marcar( uint32_t s, uint32_t segundos ) {
+      if ( vacia || ( s <= maxima && segundos < segundosMaxima ) ) {
+        reiniciar( s, segundos );
+        return true;
+      }
+      bool nueva = marcarSecuencia( s );
+      if ( s == maxima ) segundosMaxima = segundos;
+      return nueva;
+    }
+  };
+
+  /**
+   * @class IndiceDuplicados
+   * @brief Una VentanaSecuencias por dispositivo.
+   */
+  class IndiceDuplicados {
+
+  private:
+    std::unordered_map<uint64_t, VentanaSecuencias> ventanas;
+
+  public:
+    /**
+     * @brief Comprueba si una trama es nueva y la registra.
+     * @param dispositivo Dirección de la placa.
+     * @param secuencia Número de secuencia de la trama.
+     * @param segundos Tiempo desde el arranque de la trama.
+     * @return true si no se había visto antes.
+     */
+    bool esNueva( uint64_t dispositivo, uint32_t secuencia, uint32_t segundos ) {
+      return ventanas[ dispositivo ].marcar( secuencia, segundos );
+    }
+
+    /**
+     * @brief Número de dispositivos en el índice.
+     */
+    size_t dispositivos() const { return ventanas.size(); }
+  };
+
+} // namespace pasarela
+
+#endif
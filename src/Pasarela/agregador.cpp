@@ -0,0 +1,156 @@
+/**
+ * @file agregador.cpp
+ * @brief Herramienta de línea de órdenes de la agregación en ventanas (Agregador.h).
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Decodifica una captura, la pasa por el AgregadorVentanas y escribe
+ * en CSV el resumen de cada placa (medias de 1 min, 1 h y 8 h y máximo de
+ * CO2). Con `--banco` mide las actualizaciones por segundo con una flota
+ * sintética, probando de 1 hilo hasta los indicados.
+ *
+ * **Compilación** (desde src/Pasarela):
+ *
+ *     g++ -std=c++17 -O2 -pthread agregador.cpp -o agregador
+ *
+ * **Uso:**
+ *
+ *     agregador [-j hilos] [--ahora segundos] captura
+ *     agregador --banco dispositivos [--horas N] [-j hilos]
+ */
+
+#include "Agregador.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace pasarela;
+
+/// @brief Periodo de muestreo de las placas sintéticas (µs).
+const uint64_t PERIODO_SINTETICO_US = 30000000;
+
+/**
+ * @brief Escribe un valor del resumen (vacío si la ventana no tiene muestras).
+ */
+void escribirCampo( double v ) {
+  if ( std::isnan( v ) ) printf( "," );
+  else printf( ",%.1f", v );
+}
+
+/**
+ * @brief Decodifica una captura, la agrega y escribe el resumen por placa.
+ * @param ahoraUs Instante de la consulta (0 = última muestra de cada placa).
+ */
+int resumirCaptura( const std::string & ruta, unsigned hilos, uint64_t ahoraUs ) {
+  Captura captura = Captura::cargar( ruta );
+  std::vector<Muestra> serie = decodificarCaptura( captura, hilos );
+
+  AgregadorVentanas agregador;
+  auto t0 = std::chrono::steady_clock::now();
+  agregador.anyadir( serie.data(), serie.size(), hilos );
+  double s = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+
+  printf( "dispositivo,ultimo_us,o3_1m,o3_1h,o3_8h,co2_1m,co2_1h,co2_8h,temp_1h,co2_max_1m,co2_max_1h,co2_max_8h\n" );
+  agregador.recorrer( [ & ]( uint64_t d, const Resumen & r ) {
+    printf( "%012llx,%llu", (unsigned long long) d, (unsigned long long) r.ultimoUs );
+    for ( int i = 0; i < 3; i++ ) escribirCampo( r.o3[i] );
+    for ( int i = 0; i < 3; i++ ) escribirCampo( r.co2[i] );
+    escribirCampo( r.temperatura[1] / 10.0 );
+    for ( int i = 0; i < 3; i++ ) escribirCampo( r.co2Maximo[i] == INT32_MIN ? NAN : r.co2Maximo[i] );
+    printf( "\n" );
+  }, ahoraUs );
+
+  std::cerr << "muestras: " << serie.size() << "  dispositivos: " << agregador.dispositivos()
+            << "  actualizaciones/s: " << serie.size() / s << "\n";
+  return 0;
+}
+
+/**
+ * @brief Mide las actualizaciones por segundo con una flota sintética.
+ * @param numDispositivos Placas.
+ * @param horas Horas de datos por placa.
+ * @param hilosMax Se prueba con 1, 2, 4... hasta este número de hilos.
+ */
+int banco( unsigned numDispositivos, double horas, unsigned hilosMax ) {
+  const uint64_t numInstantes = (uint64_t)( horas * 3600e6 / PERIODO_SINTETICO_US );
+  std::mt19937 generador( 1 );
+  std::normal_distribution<double> ruido( 0.0, 2.0 );
+  std::uniform_int_distribution<int> retardo( 0, 50000 );
+
+  // Las placas intercaladas en el tiempo, como sale del decodificador
+  std::vector<Muestra> serie;
+  serie.reserve( numInstantes * numDispositivos * 3 );
+  for ( uint64_t k = 0; k < numInstantes; k++ ) {
+    double h = k * ( PERIODO_SINTETICO_US / 3.6e9 );
+    for ( unsigned d = 0; d < numDispositivos; d++ ) {
+      Muestra m;
+      m.tiempoUs = k * PERIODO_SINTETICO_US + (uint64_t) retardo( generador );
+      m.dispositivo = 0xC0DE00000000ULL | d;
+      m.secuencia = (uint32_t) k;
+      m.alarmas = 0;
+      m.magnitud = O3_PPB;
+      m.valor = (int32_t) std::lround( 60 + 40 * std::sin( 2 * M_PI * h / 24.0 + d ) + ruido( generador ) );
+      serie.push_back( m );
+      m.magnitud = TEMPERATURA_X10;
+      m.valor = (int32_t)( 220 + ( d % 50 ) + std::lround( ruido( generador ) ) );
+      serie.push_back( m );
+      m.magnitud = CO2_PPM;
+      m.valor = (int32_t) std::lround( 800 + 400 * std::sin( 2 * M_PI * h / 8.0 + d ) + 5 * ruido( generador ) );
+      serie.push_back( m );
+    }
+  }
+
+  std::cout << "dispositivos: " << numDispositivos << "  horas: " << horas << "  muestras: " << serie.size() << "\n";
+  double referencia = 0;
+  for ( unsigned hilos = 1; hilos <= hilosMax; hilos *= 2 ) {
+    AgregadorVentanas agregador;
+    auto t0 = std::chrono::steady_clock::now();
+    agregador.anyadir( serie.data(), serie.size(), hilos );
+    double s = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+
+    // Suma de control: no depende del número de hilos ni del orden
+    double control = 0;
+    agregador.recorrer( [ & ]( uint64_t, const Resumen & r ) { control += r.o3[2] + r.co2Maximo[1]; } );
+    if ( hilos == 1 ) referencia = control;
+
+    printf( "hilos: %u  actualizaciones/s: %.0f  ns/actualización: %.1f  control: %.3f%s\n", hilos,
+            serie.size() / s, s * 1e9 / serie.size(), control,
+            std::fabs( control - referencia ) > 1e-6 * std::fabs( referencia ) ? "  (DISTINTO)" : "" );
+    if ( hilos * 2 > hilosMax && hilos != hilosMax ) hilos = hilosMax / 2;
+  }
+  return 0;
+}
+
+int main( int argc, char * argv[] ) {
+  std::string rutaCaptura;
+  unsigned hilos = 0;
+  unsigned dispositivosBanco = 0;
+  double horas = 1;
+  double ahora = 0;
+
+  for ( int i = 1; i < argc; i++ ) {
+    std::string a = argv[i];
+    if ( a == "-j" && i + 1 < argc ) hilos = (unsigned) atoi( argv[++i] );
+    else if ( a == "--banco" && i + 1 < argc ) dispositivosBanco = (unsigned) atoi( argv[++i] );
+    else if ( a == "--horas" && i + 1 < argc ) horas = atof( argv[++i] );
+    else if ( a == "--ahora" && i + 1 < argc ) ahora = atof( argv[++i] );
+    else rutaCaptura = a;
+  }
+  if ( hilos == 0 ) hilos = std::max( 1u, std::thread::hardware_concurrency() );
+
+  try {
+    if ( dispositivosBanco > 0 ) return banco( dispositivosBanco, horas, hilos );
+    if ( rutaCaptura.empty() ) {
+      std::cerr << "uso: agregador [-j hilos] [--ahora segundos] captura\n"
+                << "     agregador --banco dispositivos [--horas N] [-j hilos]\n";
+      return 2;
+    }
+    return resumirCaptura( rutaCaptura, hilos, (uint64_t)( ahora * 1e6 ) );
+  } catch ( const std::exception & e ) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+}
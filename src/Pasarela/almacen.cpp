@@ -0,0 +1,334 @@
+/**
+ * @file almacen.cpp
+ * @brief Herramienta de línea de órdenes del almacén de series (AlmacenSeries.h).
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Ingiere capturas decodificadas en el almacén, responde a consultas
+ * típicas (medias horarias de una placa, pico de cada placa) y mide la
+ * velocidad de ingesta y de recorrido con datos sintéticos.
+ *
+ * **Compilación** (desde src/Pasarela):
+ *
+ *     g++ -std=c++17 -O2 -pthread almacen.cpp -o almacen
+ *
+ * **Uso:**
+ *
+ *     almacen -d dir -i captura [-j hilos]
+ *     almacen -d dir --horarias dispositivo [-m magnitud]
+ *     almacen -d dir --pico [-m magnitud]
+ *     almacen [-d dir] --banco dispositivos [--dias N]
+ *     almacen --comprobar
+ *
+ * La magnitud va por su nombre (o3_ppb, temp_x10, co2_ppm, bateria, ruido);
+ * por defecto o3_ppb.
+ *
+ * `--banco` trabaja en un subdirectorio nuevo de `dir` (o del directorio
+ * temporal del sistema) y lo borra al terminar; nunca toca lo que ya hubiera.
+ *
+ * Con `--comprobar` escribe en un directorio temporal columnas con un bloque
+ * cortado a mano, les añade muestras y falla si no se leen todas las de los
+ * bloques completos y las nuevas.
+ */
+
+#include "AlmacenSeries.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include <unistd.h>
+
+using namespace pasarela;
+
+/// @brief Periodo de muestreo de las placas sintéticas (µs).
+const uint64_t PERIODO_SINTETICO_US = 30000000;
+/// @brief Una hora (µs).
+const uint64_t HORA_US = 3600000000ULL;
+
+/**
+ * @brief Magnitud a partir de su nombre.
+ * @return 0 si el nombre no es válido.
+ */
+uint8_t magnitudPorNombre( const std::string & nombre ) {
+  for ( uint8_t m = O3_PPB; m <= RUIDO; m++ ) {
+    if ( nombre == nombreMagnitud( m ) ) return m;
+  }
+  return 0;
+}
+
+/**
+ * @brief Segundos transcurridos desde t0.
+ */
+double segundosDesde( std::chrono::steady_clock::time_point t0 ) {
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+}
+
+/**
+ * @brief Crea un directorio nuevo, que no existía, dentro de otro.
+ * @param padre Directorio en el que se crea.
+ * @param prefijo Comienzo del nombre.
+ */
+std::filesystem::path crearDirectorioNuevo( const std::filesystem::path & padre, const std::string & prefijo ) {
+  std::filesystem::create_directories( padre );
+  for ( unsigned n = 0; ; n++ ) {
+    std::filesystem::path d = padre / ( prefijo + "-" + std::to_string( getpid() ) + "-" + std::to_string( n ) );
+    if ( std::filesystem::create_directory( d ) ) return d;
+  }
+}
+
+/**
+ * @brief Decodifica una captura y añade su serie al almacén.
+ */
+int ingerir( AlmacenSeries & almacen, const std::string & ruta, unsigned hilos ) {
+  Captura captura = Captura::cargar( ruta );
+  Estadisticas est;
+  std::vector<Muestra> serie = decodificarCaptura( captura, hilos, &est );
+
+  auto t0 = std::chrono::steady_clock::now();
+  for ( const Muestra & m : serie ) almacen.anyadir( m );
+  almacen.volcar();
+  double s = segundosDesde( t0 );
+
+  std::cerr << "muestras: " << serie.size() << "  descartadas (fuera de orden): " << almacen.getDescartadas()
+            << "  bytes: " << almacen.getBytesEscritos() << "  muestras/s: " << serie.size() / s << "\n";
+  if ( almacen.getBytesRecortados() > 0 ) {
+    std::cerr << "bytes de bloques cortados recortados: " << almacen.getBytesRecortados() << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Escribe en CSV las medias horarias de una columna.
+ */
+int horarias( const AlmacenSeries & almacen, uint64_t dispositivo, uint8_t magnitud ) {
+  ColumnaMapeada col = almacen.abrir( dispositivo, magnitud );
+  if ( col.indice().empty() ) return 0;
+  uint64_t t0 = col.indice().front().tInicio / HORA_US * HORA_US;
+  uint64_t t1 = col.indice().back().tFin + 1;
+
+  printf( "hora_s,muestras,media,minimo,maximo\n" );
+  std::vector<Agregado> horas = col.agregarPorIntervalos( t0, t1, HORA_US );
+  for ( size_t h = 0; h < horas.size(); h++ ) {
+    const Agregado & a = horas[h];
+    if ( a.muestras == 0 ) continue;
+    printf( "%llu,%llu,%.2f,%d,%d\n", (unsigned long long)( ( t0 + h * HORA_US ) / 1000000 ),
+            (unsigned long long) a.muestras, a.media(), a.minimo, a.maximo );
+  }
+  return 0;
+}
+
+/**
+ * @brief Escribe en CSV el pico de cada dispositivo y cuándo ocurrió.
+ * @details El índice dice qué bloque tiene el máximo: solo se decodifica ese.
+ */
+int picos( const AlmacenSeries & almacen, uint8_t magnitud ) {
+  printf( "dispositivo,pico,tiempo_us\n" );
+  for ( uint64_t d : almacen.dispositivos() ) {
+    if ( ! almacen.existe( d, magnitud ) ) continue;
+    ColumnaMapeada col = almacen.abrir( d, magnitud );
+    const EntradaIndice * mejor = nullptr;
+    for ( const EntradaIndice & e : col.indice() ) {
+      if ( mejor == nullptr || e.maximo > mejor->maximo ) mejor = &e;
+    }
+    if ( mejor == nullptr ) continue;
+    uint64_t cuando = 0;
+    col.recorrer( mejor->tInicio, mejor->tFin + 1, [ & ]( uint64_t t, int32_t v ) {
+      if ( v == mejor->maximo && cuando == 0 ) cuando = t;
+    } );
+    printf( "%012llx,%d,%llu\n", (unsigned long long) d, mejor->maximo, (unsigned long long) cuando );
+  }
+  return 0;
+}
+
+/**
+ * @brief Mide ingesta y recorrido con placas sintéticas.
+ * @param dir Almacén (directorio nuevo y vacío).
+ * @param numDispositivos Placas.
+ * @param dias Días de datos por placa.
+ */
+int banco( const std::string & dir, unsigned numDispositivos, double dias ) {
+  const uint64_t numInstantes = (uint64_t)( dias * 86400e6 / PERIODO_SINTETICO_US );
+  const uint8_t magnitudes[4] = { O3_PPB, TEMPERATURA_X10, CO2_PPM, BATERIA };
+  std::mt19937 generador( 1 );
+  std::normal_distribution<double> ruido( 0.0, 2.0 );
+  std::uniform_int_distribution<int> retardo( 0, 50000 );
+
+  // --- Ingesta: las placas intercaladas en el tiempo, como sale del decodificador ---
+  uint64_t total = 0, bytes = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    AlmacenSeries almacen( dir );
+    for ( uint64_t k = 0; k < numInstantes; k++ ) {
+      double horas = k * ( PERIODO_SINTETICO_US / 3.6e9 );
+      for ( unsigned d = 0; d < numDispositivos; d++ ) {
+        uint64_t t = k * PERIODO_SINTETICO_US + (uint64_t) retardo( generador );
+        uint64_t dispositivo = 0xC0DE00000000ULL | d;
+        int32_t valores[4] = {
+          (int32_t) std::lround( 60 + 40 * std::sin( 2 * M_PI * horas / 24.0 + d ) + ruido( generador ) ),
+          (int32_t)( 220 + ( d % 50 ) + std::lround( ruido( generador ) ) ),
+          (int32_t) std::lround( 800 + 400 * std::sin( 2 * M_PI * horas / 8.0 + d ) + 5 * ruido( generador ) ),
+          (int32_t)( 100 - ( k * 100 ) / ( numInstantes + 1 ) )
+        };
+        for ( int i = 0; i < 4; i++ ) almacen.anyadir( dispositivo, magnitudes[i], t, valores[i] );
+        total += 4;
+      }
+    }
+    almacen.volcar();
+    bytes = almacen.getBytesEscritos();
+  }
+  double sIngesta = segundosDesde( t0 );
+
+  // --- Recorrido completo: decodifica todas las muestras ---
+  AlmacenSeries almacen( dir );
+  std::vector<uint64_t> dispositivos = almacen.dispositivos();
+  std::vector<ColumnaMapeada> columnas;
+  for ( uint64_t d : dispositivos ) {
+    for ( uint8_t m : magnitudes ) columnas.push_back( almacen.abrir( d, m ) );
+  }
+  int64_t suma = 0;
+  uint64_t recorridas = 0;
+  t0 = std::chrono::steady_clock::now();
+  for ( const ColumnaMapeada & c : columnas ) {
+    c.recorrer( 0, UINT64_MAX, [ & ]( uint64_t, int32_t v ) { suma += v; recorridas++; } );
+  }
+  double sRecorrido = segundosDesde( t0 );
+
+  // --- Medias horarias de O3 de todas las placas ---
+  t0 = std::chrono::steady_clock::now();
+  uint64_t horasCalculadas = 0;
+  for ( size_t i = 0; i < columnas.size(); i += 4 ) {
+    horasCalculadas += columnas[i].agregarPorIntervalos( 0, numInstantes * PERIODO_SINTETICO_US, HORA_US ).size();
+  }
+  double sHorarias = segundosDesde( t0 );
+
+  // --- Pico de O3 de todo el periodo (solo índice) ---
+  t0 = std::chrono::steady_clock::now();
+  int32_t pico = INT32_MIN;
+  for ( size_t i = 0; i < columnas.size(); i += 4 ) {
+    pico = std::max( pico, columnas[i].agregar( 0, UINT64_MAX ).maximo );
+  }
+  double sPico = segundosDesde( t0 );
+
+  std::cout << "dispositivos: " << numDispositivos << "  dias: " << dias << "  muestras: " << total << "\n"
+            << "ingesta (muestras/s): " << total / sIngesta << "  bytes/muestra: " << (double) bytes / total << "\n"
+            << "recorrido (muestras/s): " << recorridas / sRecorrido << "  (" << bytes / sRecorrido / 1e6 << " MB/s)\n"
+            << "medias horarias de O3: " << horasCalculadas << " horas en " << sHorarias * 1000 << " ms\n"
+            << "pico de O3: " << pico << " ppb en " << sPico * 1000 << " ms\n"
+            << "suma de control: " << suma << "\n";
+  return 0;
+}
+
+/**
+ * @brief Escribe n muestras de O3 de una placa, una cada PERIODO_SINTETICO_US desde t0.
+ * @return Tiempo de la siguiente muestra.
+ */
+uint64_t escribirMuestras( const std::filesystem::path & dir, uint64_t t0, unsigned n ) {
+  AlmacenSeries almacen( dir.string() );
+  for ( unsigned i = 0; i < n; i++ ) almacen.anyadir( 1, O3_PPB, t0 + i * PERIODO_SINTETICO_US, (int32_t)( i % 100 ) );
+  almacen.volcar();
+  return t0 + n * PERIODO_SINTETICO_US;
+}
+
+/**
+ * @brief Corta el último bloque de una columna, añade muestras y comprueba cuántas se leen.
+ * @param nombre Caso (para el informe).
+ * @param dir Directorio del caso (vacío).
+ * @param quedan Bytes que quedan del segundo bloque, de 100 muestras.
+ * @return true si se leen las 100 del primer bloque y las 100 nuevas, con tiempos crecientes.
+ */
+bool comprobarCorte( const char * nombre, const std::filesystem::path & dir, uintmax_t quedan ) {
+  AlmacenSeries almacen( dir.string() );
+  std::string ruta = almacen.rutaColumna( 1, O3_PPB );
+  uint64_t t = escribirMuestras( dir, 0, 100 );
+  uintmax_t completo = std::filesystem::file_size( ruta );
+  escribirMuestras( dir, t, 100 );
+  std::filesystem::resize_file( ruta, completo + quedan );
+
+  // Las nuevas empiezan tras las del bloque cortado: también se admiten las que van después del último completo
+  escribirMuestras( dir, t + 7, 100 );
+
+  uint64_t leidas = 0, anterior = 0;
+  bool crecientes = true;
+  almacen.abrir( 1, O3_PPB ).recorrer( 0, UINT64_MAX, [ & ]( uint64_t tiempo, int32_t ) {
+    if ( leidas > 0 && tiempo <= anterior ) crecientes = false;
+    anterior = tiempo;
+    leidas++;
+  } );
+  bool bien = ( leidas == 200 && crecientes );
+  std::cout << ( bien ? "ok     " : "FALLO  " ) << nombre << " (esperadas 200, leidas " << leidas
+            << ( crecientes ? "" : ", tiempos desordenados" ) << ")\n";
+  return bien;
+}
+
+/**
+ * @brief Casos de los bloques cortados.
+ * @return Número de casos que fallan.
+ */
+int comprobar() {
+  std::filesystem::path dir = crearDirectorioNuevo( std::filesystem::temp_directory_path(), "almacen-comprobar" );
+  int fallos = 0;
+  if ( ! comprobarCorte( "bloque cortado en los datos", dir / "datos", TAM_CABECERA_BLOQUE + 50 ) ) fallos++;
+  if ( ! comprobarCorte( "bloque cortado en la cabecera", dir / "cabecera", TAM_CABECERA_BLOQUE / 2 ) ) fallos++;
+  std::filesystem::remove_all( dir );
+
+  std::cout << ( fallos == 0 ? "todo correcto\n" : "hay fallos\n" );
+  return fallos;
+}
+
+int main( int argc, char * argv[] ) {
+  std::string dir, rutaCaptura, dispositivoHorarias;
+  std::string nombreMag = "o3_ppb";
+  unsigned hilos = 0;
+  bool pico = false;
+  bool comprobacion = false;
+  unsigned dispositivosBanco = 0;
+  double dias = 7;
+
+  for ( int i = 1; i < argc; i++ ) {
+    std::string a = argv[i];
+    if ( a == "-d" && i + 1 < argc ) dir = argv[++i];
+    else if ( a == "-i" && i + 1 < argc ) rutaCaptura = argv[++i];
+    else if ( a == "-j" && i + 1 < argc ) hilos = (unsigned) atoi( argv[++i] );
+    else if ( a == "-m" && i + 1 < argc ) nombreMag = argv[++i];
+    else if ( a == "--horarias" && i + 1 < argc ) dispositivoHorarias = argv[++i];
+    else if ( a == "--pico" ) pico = true;
+    else if ( a == "--banco" && i + 1 < argc ) dispositivosBanco = (unsigned) atoi( argv[++i] );
+    else if ( a == "--dias" && i + 1 < argc ) dias = atof( argv[++i] );
+    else if ( a == "--comprobar" ) comprobacion = true;
+  }
+  if ( comprobacion ) return comprobar() == 0 ? 0 : 1;
+  uint8_t magnitud = magnitudPorNombre( nombreMag );
+  if ( dispositivosBanco > 0 ) {
+    std::filesystem::path padre = ( dir.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path( dir ) );
+    std::filesystem::path d;
+    int r = 1;
+    try {
+      d = crearDirectorioNuevo( padre, "almacen-banco" );
+      r = banco( d.string(), dispositivosBanco, dias );
+    } catch ( const std::exception & e ) {
+      std::cerr << "error: " << e.what() << "\n";
+    }
+    std::error_code ec;
+    if ( ! d.empty() ) std::filesystem::remove_all( d, ec );
+    return r;
+  }
+  if ( dir.empty() || magnitud == 0 ) {
+    std::cerr << "uso: almacen -d dir (-i captura | --horarias dispositivo | --pico) [-m magnitud] [-j hilos]\n"
+              << "     almacen [-d dir] --banco dispositivos [--dias N]\n"
+              << "     almacen --comprobar\n";
+    return 2;
+  }
+
+  try {
+    AlmacenSeries almacen( dir );
+    if ( ! rutaCaptura.empty() ) return ingerir( almacen, rutaCaptura, hilos );
+    if ( ! dispositivoHorarias.empty() ) return horarias( almacen, std::stoull( dispositivoHorarias, nullptr, 16 ), magnitud );
+    if ( pico ) return picos( almacen, magnitud );
+  } catch ( const std::exception & e ) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
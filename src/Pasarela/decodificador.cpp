@@ -0,0 +1,352 @@
+/**
+ * @file decodificador.cpp
+ * @brief Herramienta de línea de órdenes que convierte capturas en series temporales.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Lee una captura btsnoop o GTICAP, la decodifica en paralelo,
+ * descarta las repeticiones y escribe la serie temporal en CSV o en binario
+ * compacto (24 bytes por muestra: tiempo u64, dirección u48, valor i32,
+ * secuencia u32, magnitud u8 y alarmas u8, todo Little Endian).
+ *
+ * **Compilación** (desde src/Pasarela):
+ *
+ *     g++ -std=c++17 -O2 -pthread decodificador.cpp -o decodificador
+ *
+ * **Uso:**
+ *
+ *     decodificador [-j hilos] [-b] [-o salida] captura
+ *     decodificador --banco repeticiones [-j hilos] (captura | --sintetico tramas)
+ *     decodificador --comprobar
+ *
+ * Con `--comprobar` decodifica unas capturas construidas a mano (copias,
+ * reinicios de la placa, saltos de secuencia) y falla si alguna trama
+ * nueva se descarta, alguna copia se cuela o dos tramas salen con el mismo tiempo.
+ * También lee un btsnoop con eventos de varios informes y anuncios extendidos
+ * fragmentados y truncados.
+ */
+
+#include "Decodificador.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace pasarela;
+
+/**
+ * @brief Genera en memoria una captura con el patrón real de las placas.
+ * @details Cada placa repite cada payload 300 veces (un ciclo de 30 s con
+ * anuncios cada 100 ms) y las placas se intercalan como en el aire.
+ * @param numTramas Tramas a generar.
+ * @param numPlacas Placas distintas.
+ */
+std::vector<uint8_t> capturaSintetica( size_t numTramas, unsigned numPlacas ) {
+  const int REPETICIONES = 300;
+  EscritorCaptura escritor;
+  for ( size_t k = 0; k < numTramas; k++ ) {
+    unsigned placa = (unsigned)( k % numPlacas );
+    uint32_t ciclo = (uint32_t)( k / ( (size_t) numPlacas * REPETICIONES ) );
+    uint16_t o3 = (uint16_t)( ( ciclo * 37 + placa ) % 500 );
+    uint16_t temp = (uint16_t)( 200 + ( ciclo + placa ) % 150 );
+    uint16_t co2 = (uint16_t)( 400 + ( ciclo * 13 + placa ) % 1200 );
+    Medidas m;
+    m.o3ppb = o3;
+    m.temperaturaX10 = temp;
+    m.co2ppm = co2;
+    m.bateria = 80;
+    m.secuencia = ciclo;
+    m.segundos = ciclo * 30;
+    uint8_t ad[ 3 + 4 + TAM_TRAMA_V2 ] = { 2, 0x01, 0x06, 3 + TAM_TRAMA_V2, 0xFF, 0x4c, 0x00 };
+    empaquetarTrama( &ad[7], m );
+    escritor.anyadir( k * 100000 / numPlacas, 0xC0DE00000000ULL | placa, -60, ad, sizeof( ad ) );
+  }
+  return escritor.extraer();
+}
+
+/**
+ * @brief Añade a una captura las copias de una trama v2 de una placa.
+ * @param escritor Captura de destino.
+ * @param tiempoUs Recepción de la primera copia (las demás, cada 100 ms).
+ * @param secuencia Número de secuencia de la trama.
+ * @param segundos Tiempo desde el arranque de la trama.
+ * @param copias Veces que se recibe.
+ */
+void anyadirCopias( EscritorCaptura & escritor, uint64_t tiempoUs, uint32_t secuencia,
+                    uint32_t segundos, int copias ) {
+  Medidas m;
+  m.o3ppb = (uint16_t)( secuencia % 500 );
+  m.secuencia = secuencia;
+  m.segundos = segundos;
+  uint8_t ad[ 3 + 4 + TAM_TRAMA_V2 ] = { 2, 0x01, 0x06, 3 + TAM_TRAMA_V2, 0xFF, 0x4c, 0x00 };
+  empaquetarTrama( &ad[7], m );
+  for ( int c = 0; c < copias; c++ ) {
+    escritor.anyadir( tiempoUs + c * 100000ULL, 0xC0DE00000001ULL, -60, ad, sizeof( ad ) );
+  }
+}
+
+/**
+ * @brief Decodifica una captura y comprueba las secuencias de O3 que salen.
+ * @details Además, sus tiempos deben ser estrictamente crecientes (AlmacenSeries
+ * descarta las muestras que no avanzan).
+ * @param nombre Caso (para el informe).
+ * @param escritor Captura a decodificar.
+ * @param esperadas Secuencias de las tramas que deben salir, en orden.
+ * @return true si coinciden.
+ */
+bool comprobarCaso( const char * nombre, EscritorCaptura & escritor, const std::vector<uint32_t> & esperadas ) {
+  std::vector<uint32_t> obtenidas;
+  bool crecientes = true;
+  uint64_t anterior = 0;
+  for ( const Muestra & m : decodificarCaptura( Captura( escritor.extraer() ), 1 ) ) {
+    if ( m.magnitud != O3_PPB ) continue;
+    if ( ! obtenidas.empty() && m.tiempoUs <= anterior ) crecientes = false;
+    anterior = m.tiempoUs;
+    obtenidas.push_back( m.secuencia );
+  }
+  bool bien = ( obtenidas == esperadas && crecientes );
+  std::cout << ( bien ? "ok     " : "FALLO  " ) << nombre << " (esperadas " << esperadas.size()
+            << ", obtenidas " << obtenidas.size() << ( crecientes ? "" : ", tiempos repetidos" ) << ")\n";
+  return bien;
+}
+
+/**
+ * @brief Añade a una captura btsnoop (enlace H4) un evento LE Meta.
+ * @param captura Fichero btsnoop en construcción.
+ * @param parametros Parámetros del evento (a partir del subevento).
+ */
+void anyadirEventoLE( std::vector<uint8_t> & captura, const std::vector<uint8_t> & parametros ) {
+  std::vector<uint8_t> paquete = { 0x04, 0x3E, (uint8_t) parametros.size() };
+  paquete.insert( paquete.end(), parametros.begin(), parametros.end() );
+  uint8_t cabecera[24] = {};
+  for ( int i = 0; i < 4; i++ ) {
+    cabecera[3 - i] = cabecera[7 - i] = (uint8_t)( paquete.size() >> ( 8 * i ) );
+  }
+  cabecera[11] = 0x03; // recibido, evento
+  const uint64_t tiempo = EPOCA_BTSNOOP_US + 1000000;
+  for ( int i = 0; i < 8; i++ ) cabecera[23 - i] = (uint8_t)( tiempo >> ( 8 * i ) );
+  captura.insert( captura.end(), cabecera, cabecera + 24 );
+  captura.insert( captura.end(), paquete.begin(), paquete.end() );
+}
+
+/**
+ * @brief Informe de un evento LE Extended Advertising Report.
+ * @param estado Data Status (0 completo, 1 faltan fragmentos, 2 truncado).
+ * @param direccion Byte bajo de la dirección.
+ * @param datos Datos AD.
+ */
+std::vector<uint8_t> informeExtendido( uint8_t estado, uint8_t direccion, const std::vector<uint8_t> & datos ) {
+  std::vector<uint8_t> r( 24, 0 );
+  r[0] = (uint8_t)( estado << 5 );
+  r[3] = direccion;
+  r[11] = 1;               // SID
+  r[13] = (uint8_t) -70;   // RSSI
+  r[23] = (uint8_t) datos.size();
+  r.insert( r.end(), datos.begin(), datos.end() );
+  return r;
+}
+
+/**
+ * @brief Lectura de eventos HCI con varios informes y de anuncios extendidos fragmentados.
+ * @return true si salen los informes esperados.
+ */
+bool comprobarBtsnoop() {
+  std::vector<uint8_t> captura( CABECERA_BTSNOOP, CABECERA_BTSNOOP + 8 );
+  captura.insert( captura.end(), { 0, 0, 0, 1, 0, 0, 0x03, 0xEA } ); // versión 1, enlace 1002
+
+  // LE Advertising Report con 3 informes: cada campo es un array con uno por informe
+  anyadirEventoLE( captura, { 0x02, 3,
+                              0x00, 0x00, 0x03,                                    // tipos
+                              0x00, 0x01, 0x00,                                    // tipos de dirección
+                              0xA1, 0, 0, 0, 0, 0,  0xA2, 0, 0, 0, 0, 0,  0xA3, 0, 0, 0, 0, 0,
+                              3, 2, 0,                                             // longitudes
+                              2, 0x01, 0x06,  1, 0x09,                             // datos
+                              (uint8_t) -50, (uint8_t) -60, (uint8_t) -70 } );     // RSSI
+
+  // LE Extended Advertising Report: uno completo y el primer fragmento de otro...
+  std::vector<uint8_t> ev = { 0x0D, 2 };
+  for ( auto r : { informeExtendido( 0, 0xB1, { 2, 0x01, 0x06 } ), informeExtendido( 1, 0xC1, { 5, 0xFF, 1, 2 } ) } ) {
+    ev.insert( ev.end(), r.begin(), r.end() );
+  }
+  anyadirEventoLE( captura, ev );
+  // ...su último fragmento, uno truncado y otro completo
+  ev = { 0x0D, 3 };
+  for ( auto r : { informeExtendido( 0, 0xC1, { 3, 4 } ), informeExtendido( 2, 0xD1, { 2, 0x01 } ),
+                   informeExtendido( 0, 0xE1, { 2, 0x01, 0x06 } ) } ) {
+    ev.insert( ev.end(), r.begin(), r.end() );
+  }
+  anyadirEventoLE( captura, ev );
+
+  Captura c( std::move( captura ) );
+  std::vector<uint8_t> direcciones;
+  std::vector<int> longitudes, rssis;
+  for ( const TramaCapturada & t : c.tramas() ) {
+    direcciones.push_back( (uint8_t) t.dispositivo );
+    longitudes.push_back( t.longitud );
+    rssis.push_back( t.rssi );
+  }
+  bool bien = direcciones == std::vector<uint8_t>{ 0xA1, 0xA2, 0xA3, 0xB1, 0xE1 }
+    && longitudes == std::vector<int>{ 3, 2, 0, 3, 3 }
+    && rssis == std::vector<int>{ -50, -60, -70, -70, -70 }
+    && c.informesDescartados() == 3;
+  std::cout << ( bien ? "ok     " : "FALLO  " ) << "btsnoop con varios informes y fragmentos (esperados 5, obtenidos "
+            << c.tramas().size() << ", descartados " << c.informesDescartados() << ")\n";
+  return bien;
+}
+
+/**
+ * @brief Casos de la deduplicación por número de secuencia.
+ * @details Las placas emiten una trama cada 30 s y cada una se recibe 3 veces.
+ * @return Número de casos que fallan.
+ */
+int comprobar() {
+  const uint64_t CICLO_US = 30000000;
+  int fallos = 0;
+
+  // Arranque -> 1..n tramas, con el tiempo de la placa y el del receptor avanzando juntos
+  auto arranque = [ & ]( EscritorCaptura & e, uint64_t & t, uint32_t primera, uint32_t n,
+                         std::vector<uint32_t> & esperadas ) {
+    for ( uint32_t s = primera; s < primera + n; s++ ) {
+      anyadirCopias( e, t, s, 5 + 30 * ( s - primera ), 3 );
+      esperadas.push_back( s );
+      t += CICLO_US;
+    }
+  };
+
+  {
+    EscritorCaptura e;
+    std::vector<uint32_t> esperadas;
+    uint64_t t = 0;
+    arranque( e, t, 1, 3, esperadas );
+    if ( ! comprobarCaso( "copias de la misma trama", e, esperadas ) ) fallos++;
+  }
+  {
+    EscritorCaptura e;
+    std::vector<uint32_t> esperadas;
+    uint64_t t = 0;
+    arranque( e, t, 1, 500, esperadas );
+    arranque( e, t, 1, 400, esperadas );
+    if ( ! comprobarCaso( "reinicio con la ventana a medio llenar", e, esperadas ) ) fallos++;
+  }
+  {
+    EscritorCaptura e;
+    std::vector<uint32_t> esperadas;
+    uint64_t t = 0;
+    arranque( e, t, 1, 3, esperadas );
+    arranque( e, t, 1, 5, esperadas );
+    arranque( e, t, 1, 2, esperadas );
+    if ( ! comprobarCaso( "reinicios seguidos", e, esperadas ) ) fallos++;
+  }
+  {
+    EscritorCaptura e;
+    std::vector<uint32_t> esperadas;
+    uint64_t t = 0;
+    arranque( e, t, 1, 1500, esperadas );
+    arranque( e, t, 1, 10, esperadas );
+    if ( ! comprobarCaso( "reinicio con la ventana llena", e, esperadas ) ) fallos++;
+  }
+  {
+    // La pasarela deja de oír a la placa un rato: la secuencia salta sin reinicio
+    EscritorCaptura e;
+    std::vector<uint32_t> esperadas;
+    uint64_t t = 0;
+    arranque( e, t, 1, 10, esperadas );
+    for ( uint32_t s = 3000; s < 3005; s++ ) {
+      anyadirCopias( e, t, s, 5 + 30 * ( s - 1 ), 3 );
+      esperadas.push_back( s );
+      t += CICLO_US;
+    }
+    if ( ! comprobarCaso( "salto de secuencia sin reinicio", e, esperadas ) ) fallos++;
+  }
+  if ( ! comprobarBtsnoop() ) fallos++;
+
+  std::cout << ( fallos == 0 ? "todo correcto\n" : "hay fallos\n" );
+  return fallos;
+}
+
+/**
+ * @brief Escribe la serie temporal.
+ */
+void escribirSerie( const std::vector<Muestra> & serie, bool binario, FILE * f ) {
+  if ( binario ) {
+    for ( const Muestra & m : serie ) {
+      uint8_t r[24];
+      for ( int i = 0; i < 8; i++ ) r[i] = (uint8_t)( m.tiempoUs >> ( 8 * i ) );
+      for ( int i = 0; i < 6; i++ ) r[8 + i] = (uint8_t)( m.dispositivo >> ( 8 * i ) );
+      for ( int i = 0; i < 4; i++ ) r[14 + i] = (uint8_t)( (uint32_t) m.valor >> ( 8 * i ) );
+      for ( int i = 0; i < 4; i++ ) r[18 + i] = (uint8_t)( m.secuencia >> ( 8 * i ) );
+      r[22] = m.magnitud;
+      r[23] = m.alarmas;
+      fwrite( r, 1, sizeof( r ), f );
+    }
+    return;
+  }
+  fprintf( f, "tiempo_us,dispositivo,secuencia,magnitud,valor,alarmas\n" );
+  for ( const Muestra & m : serie ) {
+    fprintf( f, "%llu,%012llx,%u,%s,%d,%u\n", (unsigned long long) m.tiempoUs,
+             (unsigned long long) m.dispositivo, m.secuencia, nombreMagnitud( m.magnitud ),
+             m.valor, m.alarmas );
+  }
+}
+
+int main( int argc, char * argv[] ) {
+  unsigned hilos = 0;
+  bool binario = false;
+  int repeticiones = 0;
+  size_t sintetico = 0;
+  bool comprobacion = false;
+  const char * rutaSalida = nullptr;
+  const char * rutaCaptura = nullptr;
+
+  for ( int i = 1; i < argc; i++ ) {
+    std::string a = argv[i];
+    if ( a == "-j" && i + 1 < argc ) hilos = (unsigned) atoi( argv[++i] );
+    else if ( a == "-b" ) binario = true;
+    else if ( a == "-o" && i + 1 < argc ) rutaSalida = argv[++i];
+    else if ( a == "--banco" && i + 1 < argc ) repeticiones = atoi( argv[++i] );
+    else if ( a == "--sintetico" && i + 1 < argc ) sintetico = (size_t) atoll( argv[++i] );
+    else if ( a == "--comprobar" ) comprobacion = true;
+    else rutaCaptura = argv[i];
+  }
+  if ( comprobacion ) return comprobar() == 0 ? 0 : 1;
+  if ( rutaCaptura == nullptr && sintetico == 0 ) {
+    std::cerr << "uso: decodificador [-j hilos] [-b] [-o salida] [--banco N] (captura | --sintetico tramas | --comprobar)\n";
+    return 2;
+  }
+
+  try {
+    Captura captura = ( sintetico > 0 ? Captura( capturaSintetica( sintetico, 1000 ) )
+                                      : Captura::cargar( rutaCaptura ) );
+    Estadisticas est;
+
+    if ( repeticiones > 0 ) {
+      double mejor = 1e30;
+      for ( int r = 0; r < repeticiones; r++ ) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<Muestra> serie = decodificarCaptura( captura, hilos, &est );
+        double s = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+        if ( s < mejor ) mejor = s;
+      }
+      std::cout << "tramas: " << est.tramas << "  muestras: " << est.muestras
+                << "  repetidas: " << est.repetidas << "\n"
+                << "mejor tiempo (s): " << mejor << "  tramas/s: " << (double) est.tramas / mejor << "\n";
+      return 0;
+    }
+
+    std::vector<Muestra> serie = decodificarCaptura( captura, hilos, &est );
+    FILE * f = ( rutaSalida != nullptr ? fopen( rutaSalida, "wb" ) : stdout );
+    if ( f == nullptr ) throw std::runtime_error( std::string( "no se puede crear " ) + rutaSalida );
+    escribirSerie( serie, binario, f );
+    if ( f != stdout ) fclose( f );
+
+    std::cerr << "tramas: " << est.tramas << "  de placas: " << est.dePlacas
+              << "  repetidas: " << est.repetidas << "  muestras: " << est.muestras << "\n";
+    if ( captura.informesDescartados() > 0 ) {
+      std::cerr << "informes descartados (mal formados, fragmentados o truncados): " << captura.informesDescartados() << "\n";
+    }
+  } catch ( const std::exception & e ) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
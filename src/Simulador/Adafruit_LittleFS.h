@@ -0,0 +1,107 @@
+/**
+ * @file Adafruit_LittleFS.h
+ * @brief Sustituto del sistema de ficheros LittleFS de Adafruit.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Los ficheros se guardan en memoria, dentro de la placa activa.
+ */
+
+#ifndef ADAFRUIT_LITTLEFS_SIMULADO_H_INCLUIDO
+#define ADAFRUIT_LITTLEFS_SIMULADO_H_INCLUIDO
+
+#include "Arduino.h"
+
+#define FILE_O_READ 0
+#define FILE_O_WRITE 1
+
+namespace Adafruit_LittleFS_Namespace {
+
+  class Adafruit_LittleFS {
+  private:
+    using Fichero = std::pair<std::string, std::vector<uint8_t>>;
+
+  public:
+    bool begin() { return true; }
+
+    /// @brief Busca un fichero en la placa activa (nullptr si no existe).
+    std::vector<uint8_t> * buscar( const char * nombre, bool crear ) {
+      auto & ficheros = simulador::placaActual()->ficheros;
+      for ( Fichero & f : ficheros ) {
+        if ( f.first == nombre ) return &f.second;
+      }
+      if ( ! crear ) return nullptr;
+      ficheros.push_back( Fichero( nombre, {} ) );
+      return &ficheros.back().second;
+    }
+
+    bool exists( const char * nombre ) { return buscar( nombre, false ) != nullptr; }
+
+    bool remove( const char * nombre ) {
+      auto & ficheros = simulador::placaActual()->ficheros;
+      for ( size_t i = 0; i < ficheros.size(); i++ ) {
+        if ( ficheros[i].first == nombre ) { ficheros.erase( ficheros.begin() + i ); return true; }
+      }
+      return false;
+    }
+
+    /// @brief Cambia el nombre de un fichero, sustituyendo al destino si existe (atómico en LittleFS).
+    bool rename( const char * origen, const char * destino ) {
+      std::vector<uint8_t> * d = buscar( origen, false );
+      if ( d == nullptr ) return false;
+      std::vector<uint8_t> contenido = *d;
+      remove( origen );
+      *buscar( destino, true ) = contenido;
+      return true;
+    }
+  };
+
+  class File {
+  private:
+    Adafruit_LittleFS & fs;
+    std::string nombre;
+    size_t posicion = 0;
+    bool abierto = false;
+
+  public:
+    File( Adafruit_LittleFS & fs_ ) : fs( fs_ ) {}
+
+    bool open( const char * n, uint8_t modo ) {
+      std::vector<uint8_t> * d = fs.buscar( n, modo == FILE_O_WRITE );
+      if ( d == nullptr ) return false;
+      nombre = n;
+      posicion = ( modo == FILE_O_WRITE ? d->size() : 0 );
+      abierto = true;
+      return true;
+    }
+
+    int read( void * destino, uint16_t n ) {
+      std::vector<uint8_t> * d = abierto ? fs.buscar( nombre.c_str(), false ) : nullptr;
+      if ( d == nullptr ) return -1;
+      size_t quedan = d->size() - posicion;
+      if ( n > quedan ) n = (uint16_t) quedan;
+      memcpy( destino, d->data() + posicion, n );
+      posicion += n;
+      return n;
+    }
+
+    size_t write( const uint8_t * origen, size_t n ) {
+      std::vector<uint8_t> * d = abierto ? fs.buscar( nombre.c_str(), false ) : nullptr;
+      if ( d == nullptr ) return 0;
+      d->insert( d->end(), origen, origen + n );
+      posicion = d->size();
+      return n;
+    }
+
+    uint32_t size() {
+      std::vector<uint8_t> * d = fs.buscar( nombre.c_str(), false );
+      return d ? (uint32_t) d->size() : 0;
+    }
+
+    void flush() {}
+    void close() { abierto = false; }
+    explicit operator bool() const { return abierto; }
+  };
+
+} // namespace
+
+#endif
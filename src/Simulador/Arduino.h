@@ -0,0 +1,103 @@
+/**
+ * @file Arduino.h
+ * @brief Sustituto de Arduino.h para compilar el firmware en el ordenador.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Solo cubre lo que usa el sketch. El tiempo es virtual: delay()
+ * avanza el reloj de la placa activa sin esperar de verdad, por lo que un
+ * ciclo de 30 s se simula en microsegundos.
+ */
+
+#ifndef ARDUINO_SIMULADO_H_INCLUIDO
+#define ARDUINO_SIMULADO_H_INCLUIDO
+
+#include <cmath>
+#include <math.h>
+#include <cstdlib>
+#include "PlacaSimulada.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define PIN_A6 A6
+
+inline void pinMode( int, int ) {}
+inline void digitalWrite( int, int ) {}
+
+inline int analogRead( int pin ) {
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  return placa.lectorADC ? placa.lectorADC( pin ) : 0;
+}
+
+inline void delay( unsigned long ms ) { simulador::placaActual()->tiempoUs += (uint64_t) ms * 1000; }
+inline void delayMicroseconds( unsigned long us ) { simulador::placaActual()->tiempoUs += us; }
+inline unsigned long millis() { return (unsigned long)( simulador::placaActual()->tiempoUs / 1000 ); }
+inline unsigned long micros() { return (unsigned long) simulador::placaActual()->tiempoUs; }
+
+inline void randomSeed( unsigned long semilla ) { simulador::placaActual()->generador.seed( semilla ); }
+
+inline long random( long minimo, long maximo ) {
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  if ( placa.lectorAleatorio ) return placa.lectorAleatorio( minimo, maximo );
+  if ( maximo <= minimo ) return minimo;
+  return minimo + (long)( placa.generador() % (uint32_t)( maximo - minimo ) );
+}
+inline long random( long maximo ) { return random( 0, maximo ); }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/**
+ * @brief Puerto serie simulado: escribe en placa.salidaSerie si está definida.
+ */
+class SerialSimulado {
+private:
+  std::ostream * salida() const { return simulador::placaActual()->salidaSerie; }
+
+  template<typename T>
+  size_t volcar( const T & v ) {
+    if ( salida() ) (*salida()) << v;
+    return 1;
+  }
+
+public:
+  void begin( long ) {}
+  explicit operator bool() const { return true; }
+
+  size_t print( const char * s ) { return volcar( s ); }
+  size_t print( char c ) { return volcar( c ); }
+  size_t print( unsigned char v ) { return volcar( (unsigned) v ); }
+  size_t print( int v ) { return volcar( v ); }
+  size_t print( unsigned v ) { return volcar( v ); }
+  size_t print( long v ) { return volcar( v ); }
+  size_t print( unsigned long v ) { return volcar( v ); }
+  size_t print( double v, int dec = 2 ) {
+    char b[32]; snprintf( b, sizeof( b ), "%.*f", dec, v );
+    return volcar( b );
+  }
+
+  template<typename T>
+  size_t println( T v ) { size_t n = print( v ); print( "\n" ); return n; }
+  size_t println() { return print( "\n" ); }
+
+  size_t write( uint8_t b ) { return volcar( (char) b ); }
+  size_t write( const uint8_t * p, size_t n ) {
+    if ( salida() ) salida()->write( (const char *) p, n );
+    return n;
+  }
+  void flush() {}
+};
+
+inline SerialSimulado Serial;
+
+#endif
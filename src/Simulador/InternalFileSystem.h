@@ -0,0 +1,15 @@
+/**
+ * @file InternalFileSystem.h
+ * @brief Sustituto de la flash interna (InternalFS) de Adafruit.
+ * @author Rocio
+ * @date 18/10/2026
+ */
+
+#ifndef INTERNAL_FILESYSTEM_SIMULADO_H_INCLUIDO
+#define INTERNAL_FILESYSTEM_SIMULADO_H_INCLUIDO
+
+#include "Adafruit_LittleFS.h"
+
+inline Adafruit_LittleFS_Namespace::Adafruit_LittleFS InternalFS;
+
+#endif
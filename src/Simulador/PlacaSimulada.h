@@ -0,0 +1,359 @@
+/**
+ * @file PlacaSimulada.h
+ * @brief Modelo en el ordenador (host) de la placa nRF52 y de la pila Bluefruit.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Permite compilar las cabeceras del firmware (Medidor, Publicador,
+ * EmisoraBLE...) e incluso el propio sketch fuera de la placa. Cada
+ * PlacaSimulada tiene su propio reloj virtual (delay() solo avanza el reloj),
+ * su fuente de lecturas ADC, su generador aleatorio y un registro de las
+ * emisiones de radio. Las funciones de Arduino y el objeto Bluefruit actúan
+ * siempre sobre la placa activa (simulador::placaActual()), de modo que una
+ * misma herramienta puede simular muchas placas cambiando de placa activa.
+ */
+
+#ifndef PLACA_SIMULADA_H_INCLUIDO
+#define PLACA_SIMULADA_H_INCLUIDO
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// ===================== CONSTANTES DE LA PILA BLE =====================
+
+typedef uint32_t err_t;
+
+#define ERROR_NONE 0
+
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 0x06
+#define BLE_GAP_AD_TYPE_FLAGS 0x01
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME 0x09
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA 0xFF
+
+#define BLE_GAP_PHY_AUTO  0x00
+#define BLE_GAP_PHY_1MBPS 0x01
+#define BLE_GAP_PHY_2MBPS 0x02
+#define BLE_GAP_PHY_CODED 0x04
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+
+#define CHR_PROPS_BROADCAST     0x01
+#define CHR_PROPS_READ          0x02
+#define CHR_PROPS_WRITE_WO_RESP 0x04
+#define CHR_PROPS_WRITE         0x08
+#define CHR_PROPS_NOTIFY        0x10
+#define CHR_PROPS_INDICATE      0x20
+
+/// @brief Modos de seguridad de las características (subconjunto de Bluefruit).
+enum SecureMode_t {
+  SECMODE_NO_ACCESS = 0x00,
+  SECMODE_OPEN      = 0x11,
+  SECMODE_ENC_NO_MITM = 0x21,
+  SECMODE_ENC_WITH_MITM = 0x31
+};
+
+class BLEConnection;
+class BLECharacteristic;
+
+namespace simulador {
+
+  /**
+   * @brief Tramo de tiempo durante el que la placa estuvo anunciando unos mismos datos.
+   * @details Las herramientas expanden cada tramo en paquetes en el aire
+   * (uno por intervalo, más el retardo aleatorio que añade el estándar).
+   */
+  struct Emision {
+    uint64_t inicioUs = 0;                 ///< Momento de Advertising.start().
+    uint64_t finUs = UINT64_MAX;           ///< Momento de Advertising.stop() (UINT64_MAX si sigue abierta).
+    uint16_t intervalo = 0;                ///< Intervalo de anuncio (unidades de 0.625 ms).
+    int8_t potencia = 0;                   ///< Potencia de transmisión (dBm).
+    std::vector<uint8_t> datos;            ///< Estructuras AD tal y como salen al aire.
+  };
+
+} // namespace simulador
+
+// ===================== CLASES DE BLUEFRUIT SIMULADAS =====================
+
+/**
+ * @brief Datos de anuncio o de respuesta de escaneo (estructuras AD).
+ */
+class BLEAdvertisingData {
+protected:
+  std::vector<uint8_t> _datos;
+  std::string _nombre;
+
+public:
+  void setNombrePlaca( const std::string & n ) { _nombre = n; }
+
+  void clearData() { _datos.clear(); }
+
+  bool addData( uint8_t tipo, const void * datos, uint8_t len ) {
+    if ( _datos.size() + 2 + len > 31 ) return false;
+    _datos.push_back( (uint8_t)(len + 1) );
+    _datos.push_back( tipo );
+    const uint8_t * p = (const uint8_t *) datos;
+    _datos.insert( _datos.end(), p, p + len );
+    return true;
+  }
+
+  bool addFlags( uint8_t flags ) { return addData( BLE_GAP_AD_TYPE_FLAGS, &flags, 1 ); }
+
+  bool addName() {
+    return addData( BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, _nombre.data(), (uint8_t) _nombre.size() );
+  }
+
+  template<typename S>
+  bool addService( S & ) { return true; }
+
+  uint8_t count() const { return (uint8_t) _datos.size(); }
+  const uint8_t * getData() const { return _datos.data(); }
+  const std::vector<uint8_t> & datos() const { return _datos; }
+};
+
+/**
+ * @brief Beacon iBeacon: se traduce a sus estructuras AD al llamar a setBeacon().
+ */
+class BLEBeacon {
+public:
+  uint8_t uuid[16];
+  uint16_t major, minor, fabricante = 0x004c;
+  int8_t rssi;
+
+  BLEBeacon( const uint8_t * uuid_, uint16_t major_, uint16_t minor_, int8_t rssi_ )
+  : major( major_ ), minor( minor_ ), rssi( rssi_ ) {
+    memcpy( uuid, uuid_, 16 );
+  }
+
+  void setManufacturer( uint16_t f ) { fabricante = f; }
+};
+
+class BLEAdvertising : public BLEAdvertisingData {
+private:
+  uint16_t _intervalo = 160;
+  bool _anunciando = false;
+
+public:
+  bool setBeacon( BLEBeacon & b ) {
+    clearData();
+    addFlags( BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE );
+    uint8_t m[25] = { (uint8_t)(b.fabricante & 0xFF), (uint8_t)(b.fabricante >> 8), 0x02, 0x15 };
+    memcpy( &m[4], b.uuid, 16 );
+    m[20] = (uint8_t)(b.major >> 8); m[21] = (uint8_t)(b.major & 0xFF);
+    m[22] = (uint8_t)(b.minor >> 8); m[23] = (uint8_t)(b.minor & 0xFF);
+    m[24] = (uint8_t) b.rssi;
+    return addData( BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, m, 25 );
+  }
+
+  void restartOnDisconnect( bool ) {}
+  void setInterval( uint16_t rapido, uint16_t ) { _intervalo = rapido; }
+  void setFastTimeout( uint16_t ) {}
+  uint16_t getInterval() const { return _intervalo; }
+
+  bool start( uint16_t timeout = 0 );
+  bool stop();
+  bool isRunning() const { return _anunciando; }
+};
+
+/**
+ * @brief Característica GATT simulada: guarda el último valor escrito.
+ */
+class BLECharacteristic {
+public:
+  using write_cb_t = void (*)( uint16_t, BLECharacteristic *, uint8_t *, uint16_t );
+
+private:
+  std::vector<uint8_t> _valor;
+  uint16_t _maxLen = 20;
+  write_cb_t _cb = nullptr;
+  uint32_t _notificados = 0;
+
+public:
+  BLECharacteristic() {}
+  BLECharacteristic( const uint8_t * ) {}
+
+  void setProperties( uint8_t ) {}
+  void setPermission( SecureMode_t, SecureMode_t ) {}
+  void setMaxLen( uint16_t n ) { _maxLen = n; }
+  void setWriteCallback( write_cb_t cb ) { _cb = cb; }
+  err_t begin() { return ERROR_NONE; }
+
+  uint16_t write( const void * datos, uint16_t len ) {
+    if ( len > _maxLen ) len = _maxLen;
+    const uint8_t * p = (const uint8_t *) datos;
+    _valor.assign( p, p + len );
+    return len;
+  }
+  uint16_t write( const char * str ) { return write( str, (uint16_t) strlen( str ) ); }
+  uint16_t notify( const void * datos, uint16_t len ) { return write( datos, len ); }
+  uint16_t notify( const char * str ) { return write( str ); }
+  bool notify( uint16_t, const void * datos, uint16_t len ) { write( datos, len ); _notificados += len; return true; }
+
+  /// @brief Bytes notificados por conexión (suma de todas).
+  uint32_t notificados() const { return _notificados; }
+
+  /// @brief Simula la escritura de un cliente remoto (invoca el callback instalado).
+  void escrituraRemota( uint16_t connHandle, const std::vector<uint8_t> & datos ) {
+    _valor = datos;
+    if ( _cb ) _cb( connHandle, this, _valor.data(), (uint16_t) _valor.size() );
+  }
+
+  const std::vector<uint8_t> & valor() const { return _valor; }
+};
+
+class BLEService {
+public:
+  BLEService() {}
+  BLEService( const uint8_t * ) {}
+  err_t begin() { return ERROR_NONE; }
+};
+
+/**
+ * @brief Conexión simulada: acepta cualquier petición y la refleja en sus parámetros.
+ */
+class BLEConnection {
+private:
+  uint16_t _intervalo = 24, _latencia = 0, _timeout = 400, _mtu = 23, _longitudDatos = 27;
+  uint8_t _phy = BLE_GAP_PHY_1MBPS;
+
+public:
+  bool requestConnectionParameter( uint16_t intervalo, uint16_t latencia = 0, uint16_t timeout = 400 ) {
+    _intervalo = intervalo; _latencia = latencia; _timeout = timeout;
+    return true;
+  }
+  bool requestPHY( uint8_t phy = BLE_GAP_PHY_AUTO );
+  bool requestDataLengthUpdate( const void * = nullptr, void * = nullptr ) { _longitudDatos = 251; return true; }
+  bool requestMtuExchange( uint16_t mtu ) { _mtu = mtu; return true; }
+
+  uint16_t getConnectionInterval() const { return _intervalo; }
+  uint16_t getSlaveLatency() const { return _latencia; }
+  uint16_t getSupervisionTimeout() const { return _timeout; }
+  uint16_t getMtu() const { return _mtu; }
+  uint16_t getDataLength() const { return _longitudDatos; }
+  uint8_t getPHY() const { return _phy; }
+  bool connected() const { return true; }
+};
+
+class BLEPeriph {
+public:
+  using connect_cb_t = void (*)( uint16_t );
+  using disconnect_cb_t = void (*)( uint16_t, uint8_t );
+  connect_cb_t alConectar = nullptr;
+  disconnect_cb_t alDesconectar = nullptr;
+
+  void setConnectCallback( connect_cb_t cb ) { alConectar = cb; }
+  void setDisconnectCallback( disconnect_cb_t cb ) { alDesconectar = cb; }
+};
+
+/**
+ * @brief Estado Bluefruit de una placa.
+ */
+class AdafruitBluefruit {
+public:
+  BLEAdvertising Advertising;
+  BLEAdvertisingData ScanResponse;
+  BLEPeriph Periph;
+  BLEConnection laConexion;
+  int8_t potencia = 0;
+  std::string nombre;
+
+  bool begin( uint8_t = 1, uint8_t = 0 ) { return true; }
+  void setTxPower( int8_t p ) { potencia = p; }
+  void setName( const char * n ) {
+    nombre = n;
+    Advertising.setNombrePlaca( n );
+    ScanResponse.setNombrePlaca( n );
+  }
+  BLEConnection * Connection( uint16_t ) { return &laConexion; }
+};
+
+// ===================== PLACA =====================
+
+namespace simulador {
+
+  /**
+   * @brief Estado completo de una placa simulada.
+   */
+  struct PlacaSimulada {
+    uint64_t tiempoUs = 0;               ///< Reloj virtual (µs desde el arranque).
+    std::mt19937 generador { 1 };        ///< Fuente de random().
+    std::ostream * salidaSerie = nullptr; ///< Destino de Serial (nullptr = se descarta).
+
+    /// @brief Devuelve la lectura cruda del ADC para un pin (por defecto 0).
+    std::function<int( int pin )> lectorADC;
+
+    /// @brief Si está instalado, sustituye a random(min, max) (p.ej. para reproducir trazas).
+    std::function<long( long min, long max )> lectorAleatorio;
+
+    AdafruitBluefruit bluefruit;          ///< Estado BLE de esta placa.
+    std::vector<Emision> emisiones;       ///< Registro de todo lo anunciado.
+
+    /// @brief Se invoca cada vez que se abre una emisión (opcional).
+    std::function<void( const Emision & )> alEmitir;
+
+    /// @brief PHY que admite la radio (el nRF52832 no tiene Coded; el nRF52840 tiene los tres).
+    uint8_t capacidadesPHY = BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_2MBPS | BLE_GAP_PHY_CODED;
+
+    /// @brief Ficheros de la memoria flash interna (nombre -> contenido).
+    std::vector< std::pair<std::string, std::vector<uint8_t>> > ficheros;
+  };
+
+  /**
+   * @brief Placa sobre la que actúan las funciones de Arduino y Bluefruit.
+   */
+  inline PlacaSimulada * & placaActual() {
+    static PlacaSimulada porDefecto;
+    static PlacaSimulada * p = &porDefecto;
+    return p;
+  }
+
+  /**
+   * @brief Cambia la placa activa.
+   * @param placa Nueva placa activa.
+   */
+  inline void activarPlaca( PlacaSimulada & placa ) {
+    placaActual() = &placa;
+  }
+
+} // namespace simulador
+
+inline bool BLEAdvertising::start( uint16_t ) {
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  if ( _anunciando ) stop();
+  simulador::Emision e;
+  e.inicioUs = placa.tiempoUs;
+  e.intervalo = _intervalo;
+  e.potencia = placa.bluefruit.potencia;
+  e.datos = _datos;
+  placa.emisiones.push_back( e );
+  _anunciando = true;
+  if ( placa.alEmitir ) placa.alEmitir( placa.emisiones.back() );
+  return true;
+}
+
+inline bool BLEConnection::requestPHY( uint8_t phy ) {
+  uint8_t capacidades = simulador::placaActual()->capacidadesPHY;
+  if ( phy == BLE_GAP_PHY_AUTO ) phy = ( capacidades & BLE_GAP_PHY_2MBPS ) ? BLE_GAP_PHY_2MBPS : BLE_GAP_PHY_1MBPS;
+  if ( ( phy & capacidades ) == 0 ) return false;
+  _phy = phy;
+  return true;
+}
+
+inline bool BLEAdvertising::stop() {
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  if ( _anunciando && ! placa.emisiones.empty() ) {
+    placa.emisiones.back().finUs = placa.tiempoUs;
+  }
+  _anunciando = false;
+  return true;
+}
+
+/// El objeto global Bluefruit de la librería pasa a ser el de la placa activa.
+#define Bluefruit ( ::simulador::placaActual()->bluefruit )
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file Radio.h
+ * @brief Modelo de tiempo en el aire y energía de la radio BLE por PHY.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Convierte las emisiones de una PlacaSimulada en paquetes en el aire
+ * y estima cuánto tiempo está encendido el transmisor y cuánta energía gasta,
+ * para comparar los anuncios con las descargas por conexión en cada PHY.
+ *
+ * Duración de un paquete con L bytes de carga de PDU (sin la cabecera de 2):
+ * | PHY | Fórmula | Con L = 37 |
+ * |:---:|:-------:|:----------:|
+ * | 1M | 8 µs x (1 + 4 + 2 + L + 3) | 376 µs |
+ * | 2M | 4 µs x (2 + 4 + 2 + L + 3) | 192 µs |
+ * | Coded S=8 | 80 + 256 + 16 + 24 + 64 µs x (2 + L + 3) + 24 | 3088 µs |
+ *
+ * Un anuncio son 3 paquetes en 1M (uno por canal primario) con AdvA + datos:
+ * la librería de Adafruit solo emite anuncios clásicos.
+ *
+ * Las corrientes son las de la hoja de datos del nRF52840 con DC/DC a 3 V;
+ * cada paquete suma además el arranque de la radio (TIEMPO_ARRANQUE_RADIO_US).
+ * No incluye la CPU ni el reposo: solo la radio.
+ */
+
+#ifndef RADIO_SIMULADA_H_INCLUIDO
+#define RADIO_SIMULADA_H_INCLUIDO
+
+#include "PlacaSimulada.h"
+
+namespace simulador {
+
+  /// @brief Tensión de alimentación de la radio (V).
+  const double TENSION_RADIO_V = 3.0;
+  /// @brief Arranque de la radio antes de cada paquete (modo rápido, µs).
+  const uint32_t TIEMPO_ARRANQUE_RADIO_US = 40;
+  /// @brief Separación entre paquetes de una conexión (T_IFS, µs).
+  const uint32_t T_IFS_US = 150;
+  /// @brief Corriente en recepción (mA).
+  const double CORRIENTE_RX_MA = 4.6;
+
+  /**
+   * @brief Duración en el aire de un paquete.
+   * @param phy BLE_GAP_PHY_1MBPS, BLE_GAP_PHY_2MBPS o BLE_GAP_PHY_CODED (S=8).
+   * @param carga Bytes de carga de la PDU.
+   * @return µs.
+   */
+  inline uint32_t tiempoEnAireUs( uint8_t phy, uint16_t carga ) {
+    switch ( phy ) {
+      case BLE_GAP_PHY_2MBPS: return 4 * ( 11 + carga );
+      case BLE_GAP_PHY_CODED: return 720 + 64 * carga;
+      default: return 8 * ( 10 + carga );
+    }
+  }
+
+  /**
+   * @brief Corriente del transmisor según la potencia (nRF52840, DC/DC).
+   * @param potencia dBm.
+   * @return mA.
+   */
+  inline double corrienteTxMA( int8_t potencia ) {
+    if ( potencia >= 8 ) return 14.8;
+    if ( potencia >= 4 ) return 9.6;
+    if ( potencia >= 0 ) return 4.8;
+    if ( potencia >= -4 ) return 4.0;
+    if ( potencia >= -8 ) return 3.6;
+    if ( potencia >= -20 ) return 3.2;
+    return 2.7;
+  }
+
+  /**
+   * @struct CosteRadio
+   * @brief Paquetes, tiempo en el aire y energía de un evento de radio.
+   */
+  struct CosteRadio {
+    uint32_t paquetes = 0;
+    uint32_t aireUs = 0;       ///< Tiempo transmitiendo (sin arranques).
+    double energiaUJ = 0;      ///< Energía de la radio, arranques incluidos (µJ).
+
+    /**
+     * @brief Añade un paquete transmitido.
+     */
+    void transmitir( uint8_t phy, uint16_t carga, int8_t potencia ) {
+      uint32_t us = tiempoEnAireUs( phy, carga );
+      paquetes++;
+      aireUs += us;
+      energiaUJ += ( us + TIEMPO_ARRANQUE_RADIO_US ) * corrienteTxMA( potencia ) * TENSION_RADIO_V / 1000.0;
+    }
+
+    /**
+     * @brief Añade un paquete recibido (p.ej. el acuse vacío del central).
+     */
+    void recibir( uint8_t phy, uint16_t carga ) {
+      uint32_t us = tiempoEnAireUs( phy, carga ) + T_IFS_US;
+      energiaUJ += us * CORRIENTE_RX_MA * TENSION_RADIO_V / 1000.0;
+    }
+  };
+
+  /**
+   * @brief Coste de un evento de anuncio (un intervalo) de una emisión.
+   */
+  inline CosteRadio costeEventoAnuncio( const Emision & e ) {
+    CosteRadio coste;
+    const uint16_t datos = (uint16_t) e.datos.size();
+    for ( int canal = 0; canal < 3; canal++ ) coste.transmitir( BLE_GAP_PHY_1MBPS, 6 + datos, e.potencia );
+    return coste;
+  }
+
+  /**
+   * @brief Coste de enviar bytes de aplicación por una conexión con notificaciones.
+   * @details Cada notificación lleva hasta mtu - 3 bytes en PDU de hasta
+   * longitudDatos bytes (4 de L2CAP en la primera); cada PDU recibe un acuse vacío.
+   * @param phy PHY de la conexión.
+   * @param bytes Bytes de aplicación.
+   * @param mtu MTU ATT.
+   * @param longitudDatos Carga máxima de PDU (27, o 251 con Data Length Extension).
+   * @param potencia dBm.
+   */
+  inline CosteRadio costeTransferencia( uint8_t phy, uint32_t bytes, uint16_t mtu,
+                                        uint16_t longitudDatos, int8_t potencia ) {
+    CosteRadio coste;
+    const uint32_t porNotificacion = mtu - 3u;
+    while ( bytes > 0 ) {
+      uint32_t n = bytes < porNotificacion ? bytes : porNotificacion;
+      uint32_t sdu = 4 + 3 + n;   // L2CAP + cabecera ATT + valor
+      while ( sdu > 0 ) {
+        uint16_t pdu = (uint16_t)( sdu < longitudDatos ? sdu : longitudDatos );
+        coste.transmitir( phy, pdu, potencia );
+        coste.recibir( phy, 0 );
+        sdu -= pdu;
+      }
+      bytes -= n;
+    }
+    return coste;
+  }
+
+} // namespace simulador
+
+#endif
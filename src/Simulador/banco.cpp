@@ -0,0 +1,314 @@
+/**
+ * @file banco.cpp
+ * @brief Banco de pruebas de rendimiento de la cadena de datos del firmware.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Compila el sketch real sobre la placa simulada y mide, en el
+ * ordenador, las funciones puras de los caminos calientes, sin la radio ni
+ * los stubs de la placa (ADC, reloj, registro de anuncios):
+ * - la conversión del Medidor (ppmDesdeVoltios(), porcentajeBateria()),
+ * - el empaquetado de la trama (empaquetarTrama()) y su lectura,
+ * - alReves() y stringAUint8AlReves() (UUID de servicios y características),
+ * - la codificación del major del Publicador,
+ * - la evaluación de alarmas.
+ *
+ * Cada prueba procesa un lote de OPS_POR_LOTE entradas precalculadas, para
+ * que el reloj y la llamada a través de std::function no pesen en el
+ * resultado. Se calibra cuántos lotes dura cada ronda (TIEMPO_RONDA_S) y se
+ * dan RONDAS rondas: sale la mediana de ns por operación y su ruido (la
+ * desviación absoluta mediana escalada a sigma). El resultado sale en JSON por
+ * la salida estándar. Con `-b` se compara con una línea base (banco_base.json)
+ * y con `-t` se falla si alguna prueba es más lenta que la base en más de ese
+ * porcentaje más SIGMAS_RUIDO veces el ruido de la prueba (el mayor del de la
+ * base y el de la medida). La base tiene que medirse con la misma línea de
+ * compilación que la comparación.
+ *
+ * **Compilación** (desde src/Simulador):
+ *
+ *     g++ -std=c++17 -O2 -I. banco.cpp -o banco
+ *
+ * **Uso:** `banco [-f filtro] [-b base.json] [-t tolerancia%] [-o salida.json]`
+ */
+
+#include "../HolaMundoIBeacon/HolaMundoIBeacon.ino"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// @brief Operaciones de cada llamada a una prueba (entradas distintas).
+const uint32_t OPS_POR_LOTE = 1024;
+/// @brief Duración de cada ronda (s).
+const double TIEMPO_RONDA_S = 0.02;
+/// @brief Rondas por prueba (sale la mediana).
+const int RONDAS = 21;
+/// @brief Sigmas de ruido que se toleran además del porcentaje de -t.
+const double SIGMAS_RUIDO = 3.0;
+
+/// @brief Evita que el compilador elimine el trabajo medido.
+volatile uint32_t sumidero = 0;
+
+/**
+ * @brief Una prueba: nombre y un lote de OPS_POR_LOTE operaciones.
+ */
+struct Prueba {
+  std::string nombre;
+  std::function<void()> lote;
+};
+
+/**
+ * @brief Resultado de una prueba.
+ */
+struct Medicion {
+  std::string nombre;
+  uint64_t iteraciones;   ///< Operaciones de cada ronda.
+  double nsPorOp;         ///< Mediana de las rondas.
+  double ruidoNs;         ///< Desviación absoluta mediana x 1.4826 (una sigma).
+};
+
+/**
+ * @brief Valores de una línea base.
+ */
+struct ValorBase {
+  double nsPorOp = 0;
+  double ruidoNs = 0;
+};
+
+/**
+ * @brief Mediana de unos valores (los reordena).
+ */
+double mediana( std::vector<double> & v ) {
+  std::sort( v.begin(), v.end() );
+  size_t n = v.size();
+  return n % 2 ? v[n / 2] : ( v[n / 2 - 1] + v[n / 2] ) / 2;
+}
+
+/**
+ * @brief Mide una prueba: calibra los lotes de una ronda y da la mediana de RONDAS rondas.
+ */
+Medicion medir( const Prueba & p ) {
+  using reloj = std::chrono::steady_clock;
+  auto ronda = [ & ]( uint64_t lotes ) {
+    auto t0 = reloj::now();
+    for ( uint64_t i = 0; i < lotes; i++ ) p.lote();
+    return std::chrono::duration<double>( reloj::now() - t0 ).count();
+  };
+
+  uint64_t lotes = 1;
+  for ( ;; ) {
+    double s = ronda( lotes );
+    if ( s >= TIEMPO_RONDA_S ) break;
+    lotes = ( s < TIEMPO_RONDA_S / 100 ) ? lotes * 10 : (uint64_t)( lotes * TIEMPO_RONDA_S / s * 1.1 ) + 1;
+  }
+
+  const double ops = (double) lotes * OPS_POR_LOTE;
+  std::vector<double> ns;
+  for ( int k = 0; k < RONDAS; k++ ) ns.push_back( ronda( lotes ) * 1e9 / ops );
+  double m = mediana( ns );
+  std::vector<double> desviaciones;
+  for ( double x : ns ) desviaciones.push_back( std::fabs( x - m ) );
+  return { p.nombre, lotes * OPS_POR_LOTE, m, 1.4826 * mediana( desviaciones ) };
+}
+
+/**
+ * @brief Lee los ns_por_op y ruido_ns de un JSON generado por este mismo banco.
+ * @details No es un lector de JSON general: busca "nombre" y, en la misma línea, los dos valores.
+ */
+std::map<std::string, ValorBase> leerBase( const std::string & ruta ) {
+  std::ifstream f( ruta );
+  if ( ! f ) throw std::runtime_error( "no se puede abrir " + ruta );
+
+  std::map<std::string, ValorBase> base;
+  std::string linea;
+  while ( std::getline( f, linea ) ) {
+    size_t pos = linea.find( "\"nombre\": \"" );
+    if ( pos == std::string::npos ) continue;
+    pos += 11;
+    std::string nombre = linea.substr( pos, linea.find( '"', pos ) - pos );
+    ValorBase v;
+    size_t ns = linea.find( "\"ns_por_op\": " );
+    if ( ns != std::string::npos ) v.nsPorOp = atof( linea.c_str() + ns + 13 );
+    size_t ruido = linea.find( "\"ruido_ns\": " );
+    if ( ruido != std::string::npos ) v.ruidoNs = atof( linea.c_str() + ruido + 12 );
+    base[nombre] = v;
+  }
+  return base;
+}
+
+/**
+ * @brief Crea la lista de pruebas.
+ * @details Las entradas se generan al principio, con semilla fija, para que
+ * el compilador no pueda precalcular los resultados.
+ */
+std::vector<Prueba> crearPruebas() {
+  using namespace Globales;
+  std::vector<Prueba> pruebas;
+  std::mt19937 generador( 1 );
+  auto entero = [ & ]( int a, int b ) { return std::uniform_int_distribution<int>( a, b )( generador ); };
+
+  // --- Medidor: conversión a unidades físicas ---
+  static float voltiosVgas[OPS_POR_LOTE], codigosBateria[OPS_POR_LOTE];
+  for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+    voltiosVgas[i] = 1.60f + entero( 0, 20000 ) * 1e-6f;
+    codigosBateria[i] = 520.0f + entero( 0, 1000 ) * 0.1f;
+  }
+  pruebas.push_back( { "medidor.ppmDesdeVoltios", [] {
+    float suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) suma += Medidor::ppmDesdeVoltios( voltiosVgas[i], 1.65f );
+    sumidero += (uint32_t)( suma * 1000.0f );
+  } } );
+  pruebas.push_back( { "medidor.porcentajeBateria", [] {
+    uint32_t suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) suma += (uint32_t) Medidor::porcentajeBateria( codigosBateria[i] );
+    sumidero += suma;
+  } } );
+
+  // --- Trama v2 ---
+  static Medidas medidas[OPS_POR_LOTE];
+  static uint8_t tramas[OPS_POR_LOTE][TAM_TRAMA_V2];
+  for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+    medidas[i].alarmas = (uint8_t) entero( 0, 3 );
+    medidas[i].secuencia = (uint32_t) entero( 0, 1 << 30 );
+    medidas[i].segundos = (uint32_t) entero( 0, 1 << 30 );
+    medidas[i].o3ppb = (uint16_t) entero( 0, 500 );
+    medidas[i].temperaturaX10 = (uint16_t) entero( 0, 400 );
+    medidas[i].co2ppm = (uint16_t) entero( 400, 5000 );
+    medidas[i].bateria = (uint16_t) entero( 0, 100 );
+    empaquetarTrama( tramas[i], medidas[i] );
+  }
+  pruebas.push_back( { "trama.empaquetar", [] {
+    static uint8_t datos[OPS_POR_LOTE][TAM_TRAMA_V2];
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) empaquetarTrama( datos[i], medidas[i] );
+    sumidero += datos[sumidero % OPS_POR_LOTE][9];
+  } } );
+  pruebas.push_back( { "trama.desempaquetar", [] {
+    uint32_t suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+      Medidas m;
+      suma += (uint32_t) desempaquetarTrama( tramas[i], TAM_TRAMA_V2, m ) + m.o3ppb;
+    }
+    sumidero += suma;
+  } } );
+
+  // --- UUID de servicios y características ---
+  static uint8_t uuids[OPS_POR_LOTE][16];
+  static char nombres[OPS_POR_LOTE][17];
+  for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+    for ( int k = 0; k < 16; k++ ) uuids[i][k] = (uint8_t) entero( 0, 255 );
+    snprintf( nombres[i], sizeof( nombres[i] ), "GTI-PROY-3A-%04X", (unsigned) entero( 0, 0xFFFF ) );
+  }
+  pruebas.push_back( { "uuid.alReves_16", [] {
+    uint32_t suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) suma += alReves( uuids[i], 16 )[0];
+    sumidero += suma;
+  } } );
+  pruebas.push_back( { "uuid.stringAUint8AlReves", [] {
+    uint32_t suma = 0;
+    uint8_t uuid[16];
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) suma += stringAUint8AlReves( nombres[i], uuid, 16 )[i & 7];
+    sumidero += suma;
+  } } );
+
+  // --- Publicador: codificación del major del iBeacon (el minor es el valor tal cual) ---
+  static uint8_t contadores[OPS_POR_LOTE];
+  for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) contadores[i] = (uint8_t) entero( 0, 255 );
+  pruebas.push_back( { "publicador.calcularMajor", [] {
+    uint32_t suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+      suma += Publicador::calcularMajor( i & 1 ? Publicador::CO2 : Publicador::TEMPERATURA, contadores[i] );
+    }
+    sumidero += suma;
+  } } );
+
+  // --- Alarmas ---
+  static uint16_t o3[OPS_POR_LOTE], co2[OPS_POR_LOTE];
+  for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) {
+    o3[i] = (uint16_t) entero( 0, 400 );
+    co2[i] = (uint16_t) entero( 1500, 2300 );
+  }
+  pruebas.push_back( { "alarma.evaluar", [] {
+    uint32_t suma = 0;
+    for ( uint32_t i = 0; i < OPS_POR_LOTE; i++ ) suma += elEvaluador.evaluar( o3[i], co2[i] );
+    sumidero += suma;
+  } } );
+
+  return pruebas;
+}
+
+int main( int argc, char * argv[] ) {
+  std::string filtro, rutaBase, rutaSalida;
+  double tolerancia = -1;
+
+  for ( int i = 1; i + 1 < argc; i += 2 ) {
+    std::string a = argv[i];
+    if ( a == "-f" ) filtro = argv[i + 1];
+    else if ( a == "-b" ) rutaBase = argv[i + 1];
+    else if ( a == "-t" ) tolerancia = atof( argv[i + 1] );
+    else if ( a == "-o" ) rutaSalida = argv[i + 1];
+  }
+
+  std::map<std::string, ValorBase> base;
+  try {
+    if ( ! rutaBase.empty() ) base = leerBase( rutaBase );
+  } catch ( const std::exception & e ) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 2;
+  }
+
+  // El sketch escribe por Serial y emite anuncios: se descarta todo
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  placa.salidaSerie = nullptr;
+  setup();
+
+  std::vector<Medicion> mediciones;
+  for ( const Prueba & p : crearPruebas() ) {
+    if ( ! filtro.empty() && p.nombre.find( filtro ) == std::string::npos ) continue;
+    mediciones.push_back( medir( p ) );
+    placa.emisiones.clear();
+    std::cerr << p.nombre << ": " << mediciones.back().nsPorOp << " ns/op (ruido " << mediciones.back().ruidoNs << ")\n";
+  }
+
+  // --- Informe JSON ---
+  std::ostringstream json;
+  bool regresion = false;
+  json << "{\n  \"banco\": \"firmware\",\n  \"compilador\": \"" << __VERSION__ << "\",\n  \"resultados\": [\n";
+  for ( size_t i = 0; i < mediciones.size(); i++ ) {
+    const Medicion & m = mediciones[i];
+    char linea[256];
+    snprintf( linea, sizeof( linea ),
+              "    { \"nombre\": \"%s\", \"iteraciones\": %llu, \"ns_por_op\": %.3f, \"ruido_ns\": %.3f, \"ops_por_s\": %.0f",
+              m.nombre.c_str(), (unsigned long long) m.iteraciones, m.nsPorOp, m.ruidoNs, 1e9 / m.nsPorOp );
+    json << linea;
+    auto b = base.find( m.nombre );
+    if ( b != base.end() && b->second.nsPorOp > 0 ) {
+      const ValorBase & v = b->second;
+      double aceleracion = v.nsPorOp / m.nsPorOp;
+      snprintf( linea, sizeof( linea ), ", \"base_ns_por_op\": %.3f, \"aceleracion\": %.3f", v.nsPorOp, aceleracion );
+      json << linea;
+      double limite = v.nsPorOp * ( 1.0 + tolerancia / 100.0 ) + SIGMAS_RUIDO * std::max( v.ruidoNs, m.ruidoNs );
+      if ( tolerancia >= 0 && m.nsPorOp > limite ) {
+        regresion = true;
+        json << ", \"regresion\": true";
+      }
+    }
+    json << " }" << ( i + 1 < mediciones.size() ? "," : "" ) << "\n";
+  }
+  json << "  ]\n}\n";
+
+  if ( rutaSalida.empty() ) {
+    std::cout << json.str();
+  } else {
+    std::ofstream f( rutaSalida );
+    f << json.str();
+  }
+  return regresion ? 1 : 0;
+}
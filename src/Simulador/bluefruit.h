@@ -0,0 +1,14 @@
+/**
+ * @file bluefruit.h
+ * @brief Sustituto de bluefruit.h para compilar el firmware en el ordenador.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Todo el estado BLE vive en la placa activa (ver PlacaSimulada.h).
+ */
+
+#ifndef BLUEFRUIT_SIMULADO_H_INCLUIDO
+#define BLUEFRUIT_SIMULADO_H_INCLUIDO
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file energiaPHY.cpp
+ * @brief Compara en el ordenador el tiempo de radio y la energía por muestra de cada PHY.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Compila el sketch real sobre la placa simulada. Primero emite una
+ * trama v2 con EmisoraBLE, como el loop(), y pasa la emisión por el modelo de
+ * Radio.h: paquetes y µJ por evento de anuncio y por muestra (la muestra se
+ * repite en todos los eventos de su periodo). Los anuncios son siempre
+ * clásicos en 1M, así que esta es la referencia. Después calcula la descarga
+ * de la cola de medidas por conexión (una trama por notificación, con el MTU y
+ * la longitud de datos que pide el GestorConexion al conectarse) con cada
+ * PerfilConexion, pidiendo su PHY a través de EmisoraBLE::solicitarPHYConexion().
+ *
+ * Con `-c` se eligen los PHY que admite la radio simulada (máscara de
+ * BLE_GAP_PHY_*: 7 = nRF52840, 3 = nRF52832 sin Coded) para ver a qué se
+ * baja cuando un perfil no se puede aplicar.
+ *
+ * **Compilación** (desde src/Simulador):
+ *
+ *     g++ -std=c++17 -O2 -I. energiaPHY.cpp -o energiaPHY
+ *
+ * **Uso:** `energiaPHY [-c capacidades] [-p potencia] [-m muestras]`
+ */
+
+#include "../HolaMundoIBeacon/HolaMundoIBeacon.ino"
+#include "Radio.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using simulador::CosteRadio;
+
+/**
+ * @brief Nombre de un PHY para las tablas.
+ */
+const char * nombrePHY( uint8_t phy ) {
+  switch ( phy ) {
+    case BLE_GAP_PHY_1MBPS: return "1M";
+    case BLE_GAP_PHY_2MBPS: return "2M";
+    case BLE_GAP_PHY_CODED: return "Coded";
+    default: return "-";
+  }
+}
+
+int main( int argc, char * argv[] ) {
+  int capacidades = BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_2MBPS | BLE_GAP_PHY_CODED;
+  int potencia = 4;
+  int muestrasDescarga = 1000;
+
+  for ( int i = 1; i + 1 < argc; i += 2 ) {
+    std::string a = argv[i];
+    if ( a == "-c" ) capacidades = atoi( argv[i + 1] );
+    else if ( a == "-p" ) potencia = atoi( argv[i + 1] );
+    else if ( a == "-m" ) muestrasDescarga = atoi( argv[i + 1] );
+  }
+
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  placa.salidaSerie = nullptr;
+  placa.capacidadesPHY = (uint8_t) capacidades;
+  setup();
+  Globales::elPublicador.laEmisora.ajustarAnuncio( 160, (int8_t) potencia );
+
+  printf( "potencia: %d dBm  capacidades PHY: 0x%x\n\n", potencia, capacidades );
+
+  // --- Anuncio clásico de una trama, como en el loop() ---
+  Medidas m;
+  m.o3ppb = 40;
+  m.co2ppm = 600;
+  m.temperaturaX10 = 215;
+  m.bateria = 87;
+  uint8_t trama[TAM_TRAMA_V2];
+  empaquetarTrama( trama, m );
+
+  EmisoraBLE & emisora = Globales::elPublicador.laEmisora;
+  placa.emisiones.clear();
+  emisora.emitirDatosMultiples( trama, TAM_TRAMA_V2 );
+  emisora.detenerAnuncio();
+  const simulador::Emision & e = placa.emisiones.back();
+  CosteRadio anuncio = simulador::costeEventoAnuncio( e );
+  const Ajustes & ajustes = Globales::laConfiguracion.getAjustes();
+  const double eventosPorMuestra = ajustes.periodoMuestreoMs / ( e.intervalo * 0.625 );
+
+  printf( "anuncio clasico 1M (%zu bytes AD, intervalo %.1f ms, periodo %u ms)\n",
+          e.datos.size(), e.intervalo * 0.625, ajustes.periodoMuestreoMs );
+  printf( "%8s %9s %10s %10s %10s\n", "paquetes", "aire(us)", "uJ/evento", "eventos", "uJ/mstr" );
+  printf( "%8u %9u %10.1f %10.1f %10.2f\n", anuncio.paquetes, anuncio.aireUs, anuncio.energiaUJ,
+          eventosPorMuestra, anuncio.energiaUJ * eventosPorMuestra );
+
+  // --- Descarga por conexión (p.ej. las muestras guardadas mientras no había pasarela) ---
+  const uint32_t bytes = (uint32_t) muestrasDescarga * TAM_TRAMA_V2;
+  const PerfilConexion * conexiones[] = { &PERFIL_REPOSO, &PERFIL_MASIVO, &PERFIL_LARGO_ALCANCE };
+  printf( "\ndescarga de %d muestras (%u bytes) por conexion\n", muestrasDescarga, bytes );
+  printf( "%-13s %-6s %8s %10s %10s %10s\n", "perfil", "phy", "paquetes", "aire(ms)", "mJ", "uJ/mstr" );
+  for ( const PerfilConexion * p : conexiones ) {
+    uint8_t phy = Globales::elPublicador.laEmisora.solicitarPHYConexion( 0, p->phy );
+    if ( phy == 0 ) {
+      printf( "%-13s rechazado\n", p->nombre );
+      continue;
+    }
+    // Cada notificación lleva una trama: equivale a un MTU de TAM_TRAMA_V2 + 3
+    CosteRadio c = simulador::costeTransferencia( phy, bytes, TAM_TRAMA_V2 + 3, LONGITUD_DATOS_CONEXION, (int8_t) potencia );
+    printf( "%-13s %-6s %8u %10.2f %10.3f %10.2f\n", p->nombre, nombrePHY( phy ), c.paquetes,
+            c.aireUs / 1000.0, c.energiaUJ / 1000.0, c.energiaUJ / muestrasDescarga );
+  }
+  return 0;
+}
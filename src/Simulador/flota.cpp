@@ -0,0 +1,262 @@
+/**
+ * @file flota.cpp
+ * @brief Generador de carga: miles de placas simuladas anunciando a la vez.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Cada nodo es una PlacaSimulada que ejecuta el sketch real: setup()
+ * al arrancar y después loop() tras loop() sobre el reloj virtual, con sus
+ * lucecitas, la vigilancia de alarmas cada segundo y, si saltan, la ráfaga de
+ * alarma. Así las trazas de la flota no pueden separarse del firmware.
+ *
+ * El sketch guarda su estado en variables globales; cada nodo tiene su copia
+ * de la parte que cambia de un ciclo a otro (EstadoSketch) y se carga en las
+ * globales antes de cada loop() y se recoge después. El resto (emisora,
+ * configuración, gestor de conexión) es igual en todos los nodos y lo que
+ * depende de la placa ya vive en la PlacaSimulada.
+ *
+ * Además, cada nodo tiene:
+ * - deriva de reloj (±50 ppm) y desfase de arranque propios,
+ * - el retardo aleatorio de 0-10 ms que el estándar añade a cada anuncio,
+ * - una probabilidad de pérdida de paquetes y un RSSI propios,
+ * - una traza de ozono propia (ciclo diario + ruido) y batería que se descarga.
+ *
+ * Los anuncios de todos los nodos se mezclan por orden de llegada y se
+ * escriben como captura GTICAP, lista para el decodificador de la pasarela.
+ * Todo sale de la semilla: la misma semilla produce la misma captura byte a byte.
+ *
+ * **Compilación** (desde src/Simulador):
+ *
+ *     g++ -std=c++17 -O2 -I. flota.cpp -o flota
+ *
+ * **Uso:** `flota [-n nodos] [-t segundos] [-s semilla] [-p perdida%] [-o captura]`
+ */
+
+#include "../HolaMundoIBeacon/HolaMundoIBeacon.ino"
+#include "../Pasarela/Captura.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+
+/// @brief Desfase máximo de arranque entre nodos (µs): el periodo de muestreo de fábrica.
+const uint64_t DESFASE_MAXIMO_US = 30000ULL * 1000;
+/// @brief Código ADC de VREF (0.6 V con 12 bits y fondo de escala de 1.2 V).
+const int CODIGO_VREF = 2048;
+
+/**
+ * @struct EstadoSketch
+ * @brief Variables globales del sketch que cambian entre ciclos del loop().
+ */
+struct EstadoSketch {
+  Medidor elMedidor;            ///< Calibración y ajuste del sobremuestreo.
+  EvaluadorAlarmas elEvaluador; ///< Alarmas activas.
+  uint32_t cont = 0;            ///< Loop::cont.
+  Medidas ultimas;              ///< Loop::ultimas (incluye la secuencia).
+  uint32_t ultimoMillis = 0;    ///< Loop::ultimoMillis.
+  uint64_t acumuladoMs = 0;     ///< Loop::acumuladoMs.
+};
+
+/**
+ * @brief Lleva el estado de un nodo a las globales del sketch.
+ */
+void cargarEstado( const EstadoSketch & e ) {
+  Globales::elMedidor = e.elMedidor;
+  Globales::elEvaluador = e.elEvaluador;
+  Loop::cont = e.cont;
+  Loop::ultimas = e.ultimas;
+  Loop::ultimoMillis = e.ultimoMillis;
+  Loop::acumuladoMs = e.acumuladoMs;
+}
+
+/**
+ * @brief Recoge de las globales del sketch el estado de un nodo.
+ */
+void guardarEstado( EstadoSketch & e ) {
+  e.elMedidor = Globales::elMedidor;
+  e.elEvaluador = Globales::elEvaluador;
+  e.cont = Loop::cont;
+  e.ultimas = Loop::ultimas;
+  e.ultimoMillis = Loop::ultimoMillis;
+  e.acumuladoMs = Loop::acumuladoMs;
+}
+
+/**
+ * @struct Nodo
+ * @brief Una placa simulada de la flota.
+ */
+struct Nodo {
+  uint32_t id;
+  simulador::PlacaSimulada placa;
+  EstadoSketch estado;        ///< Estado del sketch entre dos loop().
+
+  double deriva = 0;          ///< Deriva del reloj (fracción, p.ej. 30e-6).
+  uint64_t desfaseUs = 0;     ///< Momento global del arranque.
+  double perdida = 0;         ///< Probabilidad de perder cada paquete.
+  int8_t rssiBase = -60;      ///< RSSI medio en el receptor.
+  double faseO3 = 0;          ///< Fase del ciclo diario de ozono.
+  double o3Medio = 0.05;      ///< Ozono medio (ppm).
+  std::mt19937 ruido;         ///< Ruido de las lecturas y del canal de radio.
+
+  std::deque<simulador::Emision> pendientes; ///< Emisiones aún por expandir en paquetes.
+  uint64_t siguienteLocalUs = 0;             ///< Próximo paquete de la emisión actual (reloj local).
+
+  /// @brief Reloj local del nodo -> reloj global del receptor.
+  uint64_t aGlobal( uint64_t localUs ) const {
+    return desfaseUs + (uint64_t)( (double) localUs * ( 1.0 + deriva ) );
+  }
+};
+
+/**
+ * @brief Instala en un nodo su traza de sensores.
+ * @details Los pines sin sensor (el que lee setup() para la semilla de
+ * random()) flotan y devuelven ruido, como en la placa.
+ */
+void instalarTraza( Nodo & n ) {
+  n.placa.lectorADC = [ &n ]( int pin ) -> int {
+    std::normal_distribution<double> ruidoADC( 0.0, 1.5 );
+    if ( pin == O3_PIN_VREF ) return CODIGO_VREF + (int) std::lround( ruidoADC( n.ruido ) );
+    if ( pin == O3_PIN_VGAS ) {
+      double horas = n.placa.tiempoUs / 3.6e9;
+      double ppm = n.o3Medio * ( 1.0 + 0.6 * std::sin( 2 * M_PI * horas / 24.0 + n.faseO3 ) );
+      double deltaV = ppm * GAIN_TIA * -SENSIBILIDAD_SENSOR * 1e-6;
+      double codigo = CODIGO_VREF + deltaV / O3_VDD * ( ( 1 << O3_ADC_BITS ) - 1 );
+      return (int) std::lround( codigo + ruidoADC( n.ruido ) );
+    }
+    if ( pin == PIN_A6 ) {
+      // Batería: de 4.1 V a 3.3 V en 48 h (divisor 2:1, ADC de 10 bits a 3.3 V)
+      double volts = 4.1 - 0.8 * std::min( 1.0, n.placa.tiempoUs / 1.728e11 );
+      return (int)( volts / 2.0 / VDD * ( ( 1 << ADC_BITS ) - 1 ) );
+    }
+    return std::uniform_int_distribution<int>( 0, ( 1 << ADC_BITS ) - 1 )( n.ruido );
+  };
+}
+
+/**
+ * @brief Pasa a la cola del nodo lo que ha anunciado su placa.
+ */
+void recogerEmisiones( Nodo & n ) {
+  for ( simulador::Emision & e : n.placa.emisiones ) n.pendientes.push_back( std::move( e ) );
+  n.placa.emisiones.clear();
+}
+
+/**
+ * @brief Arranca un nodo: setup() del sketch sobre su placa.
+ */
+void arrancar( Nodo & n ) {
+  simulador::activarPlaca( n.placa );
+  cargarEstado( EstadoSketch() );
+  setup();
+  guardarEstado( n.estado );
+  recogerEmisiones( n );
+}
+
+/**
+ * @brief Ejecuta un loop() del sketch en un nodo y guarda sus emisiones.
+ */
+void ejecutarCiclo( Nodo & n ) {
+  simulador::activarPlaca( n.placa );
+  cargarEstado( n.estado );
+  loop();
+  guardarEstado( n.estado );
+  recogerEmisiones( n );
+}
+
+/**
+ * @brief Avanza al siguiente paquete de un nodo (reloj local).
+ * @details El estándar separa cada anuncio intervalo + un retardo aleatorio de 0-10 ms.
+ */
+void avanzarPaquete( Nodo & n ) {
+  const simulador::Emision & e = n.pendientes.front();
+  n.siguienteLocalUs += (uint64_t) e.intervalo * 625
+    + std::uniform_int_distribution<uint64_t>( 0, 10000 )( n.ruido );
+  if ( n.siguienteLocalUs >= e.finUs ) {
+    n.pendientes.pop_front();
+    while ( n.pendientes.empty() ) ejecutarCiclo( n );
+    n.siguienteLocalUs = n.pendientes.front().inicioUs;
+  }
+}
+
+int main( int argc, char * argv[] ) {
+  unsigned numNodos = 1000;
+  double segundos = 600;
+  unsigned semilla = 1;
+  double perdidaPct = 5;
+  const char * rutaSalida = "flota.gticap";
+
+  for ( int i = 1; i + 1 < argc; i += 2 ) {
+    std::string a = argv[i];
+    if ( a == "-n" ) numNodos = (unsigned) atoi( argv[i + 1] );
+    else if ( a == "-t" ) segundos = atof( argv[i + 1] );
+    else if ( a == "-s" ) semilla = (unsigned) atoi( argv[i + 1] );
+    else if ( a == "-p" ) perdidaPct = atof( argv[i + 1] );
+    else if ( a == "-o" ) rutaSalida = argv[i + 1];
+  }
+
+  std::ofstream salida( rutaSalida, std::ios::binary );
+  if ( ! salida ) {
+    std::cerr << "error: no se puede crear " << rutaSalida << "\n";
+    return 1;
+  }
+  pasarela::EscritorCaptura escritor( salida );
+
+  // --- Creación de la flota ---
+  std::mt19937 generador( semilla );
+  std::vector<std::unique_ptr<Nodo>> nodos;
+  for ( unsigned i = 0; i < numNodos; i++ ) {
+    auto n = std::make_unique<Nodo>();
+    n->id = i;
+    n->ruido.seed( generador() );
+    n->deriva = std::uniform_real_distribution<double>( -50e-6, 50e-6 )( generador );
+    n->desfaseUs = std::uniform_int_distribution<uint64_t>( 0, DESFASE_MAXIMO_US )( generador );
+    n->perdida = std::uniform_real_distribution<double>( 0, 2 * perdidaPct / 100.0 )( generador );
+    n->rssiBase = (int8_t) std::uniform_int_distribution<int>( -95, -40 )( generador );
+    n->faseO3 = std::uniform_real_distribution<double>( 0, 2 * M_PI )( generador );
+    n->o3Medio = std::uniform_real_distribution<double>( 0.02, 0.12 )( generador );
+    instalarTraza( *n );
+
+    arrancar( *n );
+    while ( n->pendientes.empty() ) ejecutarCiclo( *n );
+    n->siguienteLocalUs = n->pendientes.front().inicioUs;
+    nodos.push_back( std::move( n ) );
+  }
+
+  // --- Mezcla de los anuncios por orden de llegada ---
+  using Entrada = std::pair<uint64_t, uint32_t>; // (tiempo global, nodo)
+  std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+  for ( auto & n : nodos ) cola.push( { n->aGlobal( n->siguienteLocalUs ), n->id } );
+
+  const uint64_t finUs = (uint64_t)( segundos * 1e6 );
+  size_t enviados = 0, perdidos = 0;
+  auto t0 = std::chrono::steady_clock::now();
+
+  while ( ! cola.empty() && cola.top().first < finUs ) {
+    Entrada e = cola.top();
+    cola.pop();
+    Nodo & n = *nodos[ e.second ];
+
+    if ( std::uniform_real_distribution<double>( 0, 1 )( n.ruido ) < n.perdida ) {
+      perdidos++;
+    } else {
+      const std::vector<uint8_t> & ad = n.pendientes.front().datos;
+      int8_t rssi = (int8_t)( n.rssiBase + std::uniform_int_distribution<int>( -4, 4 )( n.ruido ) );
+      escritor.anyadir( e.first, 0xC0DE00000000ULL | n.id, rssi, ad.data(), (uint8_t) ad.size() );
+      enviados++;
+    }
+
+    avanzarPaquete( n );
+    cola.push( { n.aGlobal( n.siguienteLocalUs ), n.id } );
+  }
+  escritor.terminar();
+
+  double s = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+  std::cerr << "nodos: " << numNodos << "  tiempo simulado (s): " << segundos << "\n"
+            << "paquetes: " << enviados << "  perdidos: " << perdidos << "\n"
+            << "tasa en el aire (paquetes/s): " << enviados / segundos << "\n"
+            << "generacion (paquetes/s): " << enviados / s << "\n";
+  return 0;
+}
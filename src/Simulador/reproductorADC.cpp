@@ -0,0 +1,472 @@
+/**
+ * @file reproductorADC.cpp
+ * @brief Reproduce en el ordenador trazas de lecturas crudas grabadas con GrabadorADC.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Las lecturas de la traza se sirven a analogRead() y random() de la
+ * placa simulada en el mismo orden en que se grabaron, y se vuelven a pasar
+ * por el Medidor real (promedios, conversión a ppm y porcentaje), por el
+ * evaluador de alarmas y por el empaquetado de la trama v2. La huella FNV-1a
+ * de todas las tramas permite comprobar que un cambio en el firmware no
+ * altera ni un bit del resultado; el tiempo de la reproducción da las
+ * lecturas por segundo que procesa la cadena completa.
+ *
+ * Cada medida de la traza empieza con la marca de inicio y sus lecturas
+ * siguen el canal de la primera, de modo que el número de muestras de cada
+ * promedio sale de la propia traza y no hace falta conocer los ajustes de la placa.
+ *
+ * La traza puede ser el fichero de la flash o un volcado completo del puerto
+ * serie: de este se quedan los bloques de GrabadorADC y se descarta el texto
+ * del sketch que venga entre ellos.
+ *
+ * Sin trazas de campo a mano, `-g` graba una traza sintética con el Medidor y
+ * el GrabadorADC reales (ciclo de 30 s con vigilancia cada segundo, como el
+ * loop() del sketch) sobre una señal de ozono con ruido gaussiano, y la
+ * vuelca por el puerto serie simulado mezclada con texto, como la placa. Con `-m`
+ * cambia las lecturas de cada medida (la calibración graba cinco veces más);
+ * para validar el ajuste hace falta grabar al menos tantas como sus topes.
+ * `-m 0` graba con el número de lecturas automático, como el sketch: la
+ * reproducción lo saca igualmente de la traza.
+ *
+ * Con `-a` valida el ajuste automático del sobremuestreo (Sobremuestreo.h)
+ * sobre una traza sintética de `-g`: las lecturas de Vgas, Vref y batería de
+ * la traza se sirven a un Medidor que elige solo cuántas promediar; cada
+ * medida empieza en la primera lectura de la medida grabada y, si necesita
+ * más, sigue con las siguientes. Compara lecturas, tiempo de ADC y precisión
+ * con el número fijo grabado. La precisión real de O3 es el percentil 95 del
+ * error frente al valor verdadero de la señal sintética (sin ruido ni
+ * redondeo), y el programa falla si es peor que la que declara el ajuste.
+ *
+ * **Compilación** (desde src/Simulador):
+ *
+ *     g++ -std=c++17 -O2 -I. reproductorADC.cpp -o reproductorADC
+ *
+ * **Uso:**
+ *
+ *     reproductorADC -f traza [-n repeticiones] [-e huella]
+ *     reproductorADC -f traza -g ciclos [-s semilla] [-r ruido(LSB)] [-m lecturas]
+ *     reproductorADC -f traza -a 1 [-p precision(ppb)]
+ */
+
+#include "../HolaMundoIBeacon/Medidor.h"
+#include "../HolaMundoIBeacon/Alarma.h"
+#include "../HolaMundoIBeacon/Trama.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// @brief Código ADC de VREF (0.6 V con 12 bits y fondo de escala de 1.2 V).
+const int CODIGO_VREF = 2048;
+/// @brief Número de canales de GrabadorADC.
+const int NUM_CANALES = 6;
+/// @brief Nombres de los canales (para el informe).
+const char * const NOMBRES_CANALES[NUM_CANALES] = { "vgas", "vref", "bateria", "co2", "temperatura", "o3_simulado" };
+
+/**
+ * @brief Código de Vgas de la señal sintética, antes de ruido y redondeo.
+ * @details Ozono de 60 ppb que oscila un 60 % con periodo de un día.
+ * @param tiempoUs Tiempo desde el arranque (µs).
+ */
+double codigoVgasSintetico( uint64_t tiempoUs ) {
+  double horas = tiempoUs / 3.6e9;
+  double ppm = 0.06 * ( 1.0 + 0.6 * std::sin( 2 * M_PI * horas / 24.0 ) );
+  double deltaV = ppm * GAIN_TIA * -SENSIBILIDAD_SENSOR * 1e-6;
+  return CODIGO_VREF + deltaV / O3_VDD * ( ( 1 << O3_ADC_BITS ) - 1 );
+}
+
+/**
+ * @struct Lectura
+ * @brief Un registro de la traza ya decodificado.
+ */
+struct Lectura {
+  uint32_t ms;      ///< millis() en el momento de la lectura.
+  uint16_t valor;
+  uint8_t canal;
+  bool inicio;
+};
+
+/**
+ * @brief Recupera la traza de un volcado del puerto serie.
+ * @details Junta los datos de los bloques MARCA_BLOQUE_TRAZA y descarta el
+ * texto que haya entre ellos (un bloque cortado al final también se descarta).
+ * @param volcado Bytes recibidos por el puerto serie.
+ * @return Bytes de la traza.
+ */
+std::vector<uint8_t> extraerBloques( const std::vector<uint8_t> & volcado ) {
+  std::vector<uint8_t> traza;
+  size_t pos = 0;
+  while ( pos + 3 <= volcado.size() ) {
+    if ( volcado[pos] != MARCA_BLOQUE_TRAZA[0] || volcado[pos + 1] != MARCA_BLOQUE_TRAZA[1] ) {
+      pos++;
+      continue;
+    }
+    size_t len = volcado[pos + 2];
+    if ( pos + 3 + len > volcado.size() ) break;
+    traza.insert( traza.end(), volcado.begin() + pos + 3, volcado.begin() + pos + 3 + len );
+    pos += 3 + len;
+  }
+  return traza;
+}
+
+/**
+ * @brief Lee y decodifica una traza GTIADC.
+ * @details Admite el fichero de la flash tal cual y el volcado del puerto serie.
+ * @throws std::runtime_error si el fichero no es una traza o está truncado.
+ */
+std::vector<Lectura> cargarTraza( const std::string & ruta ) {
+  std::ifstream f( ruta, std::ios::binary );
+  if ( ! f ) throw std::runtime_error( "no se puede abrir " + ruta );
+  std::vector<uint8_t> b( ( std::istreambuf_iterator<char>( f ) ), std::istreambuf_iterator<char>() );
+  if ( b.size() < 8 || memcmp( b.data(), CABECERA_TRAZA_ADC, 8 ) != 0 ) b = extraerBloques( b );
+  if ( b.size() < 12 || memcmp( b.data(), CABECERA_TRAZA_ADC, 8 ) != 0 ) {
+    throw std::runtime_error( "no es una traza GTIADC: " + ruta );
+  }
+
+  std::vector<Lectura> lecturas;
+  lecturas.reserve( b.size() / 3 );
+  uint32_t ms = leerLE( &b[8], 4 );
+  size_t pos = 12;
+  while ( pos < b.size() ) {
+    uint8_t etiqueta = b[pos++];
+    uint32_t delta = etiqueta & 0x0F;
+    if ( delta == DELTA_LARGO ) {
+      if ( pos + 4 > b.size() ) break;
+      delta = leerLE( &b[pos], 4 );
+      pos += 4;
+    }
+    if ( pos + 2 > b.size() ) break; // último registro cortado al apagar la placa
+    ms += delta;
+    uint8_t canal = ( etiqueta >> 4 ) & 0x07;
+    if ( canal >= NUM_CANALES ) throw std::runtime_error( "canal desconocido en la traza" );
+    lecturas.push_back( { ms, (uint16_t) leerLE( &b[pos], 2 ), canal, ( etiqueta & MARCA_INICIO_MEDIDA ) != 0 } );
+    pos += 2;
+  }
+  return lecturas;
+}
+
+/**
+ * @brief Canal que graba el Medidor para un pin.
+ */
+uint8_t canalDePin( int pin ) {
+  return pin == O3_PIN_VGAS ? CANAL_VGAS : pin == O3_PIN_VREF ? CANAL_VREF : CANAL_BATERIA;
+}
+
+/**
+ * @brief Resultado de una reproducción.
+ */
+struct Resultado {
+  uint64_t huella = 0xcbf29ce484222325ULL; ///< FNV-1a de 64 bits de todas las tramas.
+  size_t lecturas = 0;
+  size_t medidas = 0;
+  size_t porCanal[NUM_CANALES] = {};
+  size_t alarmas = 0;                      ///< Medidas que activaron alguna alarma.
+};
+
+/**
+ * @brief Cierra una medida: evalúa las alarmas, empaqueta la trama y la suma a la huella.
+ */
+void cerrarMedida( Resultado & r, EvaluadorAlarmas & elEvaluador, Medidas & m, uint32_t ms ) {
+  if ( elEvaluador.evaluar( m.o3ppb, m.co2ppm ) != 0 ) r.alarmas++;
+  m.alarmas = elEvaluador.getActivas();
+  m.secuencia++;
+  m.segundos = ms / 1000;
+
+  uint8_t trama[TAM_TRAMA_V2];
+  empaquetarTrama( trama, m );
+  for ( uint8_t byte : trama ) {
+    r.huella ^= byte;
+    r.huella *= 0x100000001b3ULL;
+  }
+  r.medidas++;
+}
+
+/**
+ * @brief Pasa una traza por Medidor, EvaluadorAlarmas y empaquetarTrama().
+ * @throws std::runtime_error si la traza no encaja con las lecturas que pide el Medidor.
+ */
+Resultado reproducir( const std::vector<Lectura> & lecturas ) {
+  simulador::PlacaSimulada placa;
+  simulador::activarPlaca( placa );
+
+  size_t pos = 0;
+  auto siguiente = [ & ]( uint8_t canal ) -> uint16_t {
+    if ( pos >= lecturas.size() || lecturas[pos].canal != canal ) {
+      throw std::runtime_error( "traza desincronizada en la lectura " + std::to_string( pos ) );
+    }
+    return lecturas[pos++].valor;
+  };
+  placa.lectorADC = [ & ]( int pin ) -> int { return siguiente( canalDePin( pin ) ); };
+
+  uint8_t canalAleatorio = CANAL_CO2;
+  placa.lectorAleatorio = [ & ]( long, long ) -> long { return siguiente( canalAleatorio ); };
+
+  Medidor elMedidor;
+  EvaluadorAlarmas elEvaluador;
+  Medidas m;
+  Resultado r;
+
+  while ( pos < lecturas.size() ) {
+    const Lectura & primera = lecturas[pos];
+    if ( ! primera.inicio ) throw std::runtime_error( "traza sin marca de inicio en " + std::to_string( pos ) );
+    int n = 1;
+    while ( pos + n < lecturas.size() && ! lecturas[pos + n].inicio && lecturas[pos + n].canal == primera.canal ) n++;
+    r.porCanal[primera.canal] += n;
+    r.lecturas += n;
+
+    switch ( primera.canal ) {
+    case CANAL_VREF:        elMedidor.iniciarMedidor( n ); break;
+    case CANAL_VGAS:        m.o3ppb = (uint16_t)( elMedidor.medirPPM( n ) * 1000.0f ); break;
+    case CANAL_BATERIA:     m.bateria = (uint16_t) elMedidor.medirBateria( n ); break;
+    case CANAL_CO2:         canalAleatorio = CANAL_CO2; m.co2ppm = (uint16_t) elMedidor.medirCO2(); break;
+    case CANAL_TEMPERATURA: canalAleatorio = CANAL_TEMPERATURA; m.temperaturaX10 = (uint16_t) elMedidor.medirTemperatura(); break;
+    case CANAL_O3_SIMULADO: canalAleatorio = CANAL_O3_SIMULADO; m.o3ppb = (uint16_t)( elMedidor.medirPPMSimulado() * 1000.0f ); break;
+    }
+
+    cerrarMedida( r, elEvaluador, m, primera.ms );
+  }
+  return r;
+}
+
+/**
+ * @brief Precisión real (±) de una serie de medidas: percentil 95 del error absoluto.
+ * @param errores Diferencias entre cada medida y el valor verdadero.
+ */
+double precisionReal( std::vector<double> errores ) {
+  if ( errores.empty() ) return 0;
+  for ( double & e : errores ) e = std::fabs( e );
+  size_t k = (size_t)( 0.95 * ( errores.size() - 1 ) );
+  std::nth_element( errores.begin(), errores.begin() + k, errores.end() );
+  return errores[k];
+}
+
+/**
+ * @brief Pasa las lecturas de la traza por el Medidor con el número de lecturas automático.
+ * @param lecturas Traza.
+ * @param precisionO3 Precisión deseada de O3 (± ppb); 0 para la del Medidor.
+ * @return 0 si la precisión declarada es fiel, 1 si no.
+ */
+int validarAjuste( const std::vector<Lectura> & lecturas, float precisionO3 ) {
+  simulador::PlacaSimulada placa;
+  simulador::activarPlaca( placa );
+
+  // Una señal continua por canal
+  std::vector<uint16_t> senyal[NUM_CANALES_AJUSTE];
+  size_t cursor[NUM_CANALES_AJUSTE] = {};
+  size_t grabadas[NUM_CANALES_AJUSTE] = {};
+  for ( const Lectura & l : lecturas ) {
+    if ( l.canal < NUM_CANALES_AJUSTE ) senyal[l.canal].push_back( l.valor );
+  }
+  bool agotada = false;
+  placa.lectorADC = [ & ]( int pin ) -> int {
+    uint8_t c = canalDePin( pin );
+    if ( cursor[c] >= senyal[c].size() ) { agotada = true; return senyal[c].empty() ? 0 : senyal[c].back(); }
+    return senyal[c][cursor[c]++];
+  };
+
+  Medidor elMedidor;
+  AjusteSobremuestreo & ajuste = elMedidor.getAjuste();
+  if ( precisionO3 > 0 ) ajuste.setObjetivo( CANAL_VGAS, precisionO3 );
+
+  size_t fijas[NUM_CANALES_AJUSTE] = {};
+  double tiempoFijoUs[NUM_CANALES_AJUSTE] = {};
+  std::vector<double> errorFijo, errorAjustado;
+
+  for ( size_t pos = 0; pos < lecturas.size() && ! agotada; ) {
+    const Lectura & primera = lecturas[pos];
+    size_t n = 1;
+    while ( pos + n < lecturas.size() && ! lecturas[pos + n].inicio && lecturas[pos + n].canal == primera.canal ) n++;
+    uint8_t c = primera.canal;
+    if ( c < NUM_CANALES_AJUSTE ) {
+      // El reloj sigue al de la traza (solo avanza)
+      if ( primera.ms * 1000ULL > placa.tiempoUs ) placa.tiempoUs = primera.ms * 1000ULL;
+      // Empieza donde empieza la medida grabada, aunque la anterior leyera menos
+      cursor[c] = grabadas[c];
+      grabadas[c] += n;
+      fijas[c] += n;
+      tiempoFijoUs[c] += n * ( c == CANAL_BATERIA ? 1000.0 : 2000.0 );
+
+      if ( c == CANAL_VREF ) {
+        elMedidor.iniciarMedidor( MUESTRAS_AUTOMATICAS );
+      } else if ( c == CANAL_BATERIA ) {
+        elMedidor.medirBateria( MUESTRAS_AUTOMATICAS );
+      } else {
+        const double verdadero = codigoVgasSintetico( primera.ms * 1000ULL );
+        double suma = 0;
+        for ( size_t i = 0; i < n; i++ ) suma += lecturas[pos + i].valor;
+        errorFijo.push_back( ( suma / n - verdadero ) * PPB_POR_CODIGO_O3 );
+        float vg = elMedidor.leerVgas( MUESTRAS_AUTOMATICAS );
+        errorAjustado.push_back( ( vg / O3_VDD * ( ( 1 << O3_ADC_BITS ) - 1 ) - verdadero ) * PPB_POR_CODIGO_O3 );
+      }
+    }
+    pos += n;
+  }
+  if ( agotada ) std::cerr << "(la señal de algún canal se agotó antes del final de la traza: grábela con más lecturas, -m)\n";
+
+  printf( "%-8s %7s %9s %9s %12s %12s %10s %10s\n", "canal", "medidas", "lect.fijo", "lect.auto",
+          "adc fijo(ms)", "adc auto(ms)", "precision", "recortadas" );
+  for ( uint8_t c = 0; c < NUM_CANALES_AJUSTE; c++ ) {
+    const CanalAjuste & a = ajuste.getCanal( c );
+    if ( a.medidas == 0 ) continue;
+    char precision[32];
+    snprintf( precision, sizeof( precision ), "+-%.2f %s", a.sumaPrecision / a.medidas, a.unidad );
+    printf( "%-8s %7u %9zu %9u %12.0f %12.0f %10s %10u\n", a.nombre, a.medidas, fijas[c], a.muestras,
+            tiempoFijoUs[c] / 1000, a.tiempoUs / 1000.0, precision, a.recortadas );
+  }
+
+  const CanalAjuste & vgas = ajuste.getCanal( CANAL_VGAS );
+  if ( vgas.medidas < 3 ) return 0;
+  double declarada = vgas.sumaPrecision / vgas.medidas;
+  double real = precisionReal( errorAjustado );
+  printf( "\nO3: objetivo +-%.2f ppb  declarada +-%.2f  real +-%.2f (con el numero fijo: +-%.2f, %.1f lecturas)\n",
+          vgas.objetivo, declarada, real, precisionReal( errorFijo ), (double) fijas[CANAL_VGAS] / errorFijo.size() );
+  if ( real > 1.25 * declarada ) {
+    std::cerr << "la precision real es peor que la declarada\n";
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Graba una traza sintética con el Medidor y el GrabadorADC reales.
+ * @param ruta Fichero de salida.
+ * @param ciclos Ciclos de 30 s a grabar.
+ * @param semilla Semilla del ruido.
+ * @param ruidoLSB Desviación típica del ruido del ADC (códigos).
+ * @param nAvg Lecturas por medida (la calibración lee 5 veces más), o MUESTRAS_AUTOMATICAS.
+ * @return Resultado de la cadena en directo (su huella debe coincidir con la de la reproducción).
+ */
+Resultado grabarSintetica( const std::string & ruta, int ciclos, unsigned semilla, double ruidoLSB, int nAvg ) {
+  std::ofstream salida( ruta, std::ios::binary );
+  if ( ! salida ) throw std::runtime_error( "no se puede crear " + ruta );
+
+  simulador::PlacaSimulada placa;
+  simulador::activarPlaca( placa );
+  placa.salidaSerie = &salida;
+  placa.generador.seed( semilla );
+  std::mt19937 ruido( semilla );
+
+  placa.lectorADC = [ & ]( int pin ) -> int {
+    std::normal_distribution<double> n( 0.0, ruidoLSB );
+    if ( pin == O3_PIN_VREF ) return CODIGO_VREF + (int) std::lround( n( ruido ) );
+    if ( pin == O3_PIN_VGAS ) {
+      double codigo = codigoVgasSintetico( placa.tiempoUs );
+      return std::max( 0, std::min( 4095, (int) std::lround( codigo + n( ruido ) ) ) );
+    }
+    return 600 + (int) std::lround( n( ruido ) ); // batería (~3.9 V tras el divisor)
+  };
+
+  GrabadorADC elGrabador;
+  Medidor elMedidor;
+  EvaluadorAlarmas elEvaluador;
+  Medidas m;
+  Resultado r;
+  elGrabador.empezar();
+  elMedidor.setGrabador( &elGrabador );
+
+  // Cada medida se cierra con el millis() de su primera lectura, como en la reproducción
+  auto medir = [ & ]( auto && accion ) {
+    uint32_t ms = millis();
+    accion();
+    cerrarMedida( r, elEvaluador, m, ms );
+  };
+
+  elMedidor.iniciarMedidor( 5 * nAvg );
+  cerrarMedida( r, elEvaluador, m, 0 );
+  for ( int c = 0; c < ciclos; c++ ) {
+    delay( 3500 ); // lucecitas()
+    medir( [ & ] { m.o3ppb = (uint16_t)( elMedidor.medirPPM( nAvg ) * 1000.0f ); } );
+    medir( [ & ] { m.co2ppm = (uint16_t) elMedidor.medirCO2(); } );
+    medir( [ & ] { m.temperaturaX10 = (uint16_t) elMedidor.medirTemperatura(); } );
+    medir( [ & ] { m.bateria = (uint16_t) elMedidor.medirBateria( nAvg ); } );
+    for ( int s = 0; s < 30; s++ ) {
+      delay( PERIODO_VIGILANCIA_MS );
+      medir( [ & ] { m.o3ppb = (uint16_t)( elMedidor.medirPPM( nAvg ) * 1000.0f ); } );
+      medir( [ & ] { m.co2ppm = (uint16_t) elMedidor.medirCO2(); } );
+    }
+    Serial.print( "---- ciclo " );
+    Serial.println( c );
+    elGrabador.volcar();
+  }
+  r.lecturas = elGrabador.getMuestras();
+  return r;
+}
+
+int main( int argc, char * argv[] ) {
+  std::string ruta;
+  int repeticiones = 1;
+  int ciclosGrabar = 0;
+  unsigned semilla = 1;
+  double ruidoLSB = 1.5;
+  int nAvg = 10;
+  const char * huellaEsperada = nullptr;
+  bool ajustar = false;
+  float precisionO3 = 0;
+
+  for ( int i = 1; i + 1 < argc; i += 2 ) {
+    std::string a = argv[i];
+    if ( a == "-f" ) ruta = argv[i + 1];
+    else if ( a == "-n" ) repeticiones = std::max( 1, atoi( argv[i + 1] ) );
+    else if ( a == "-e" ) huellaEsperada = argv[i + 1];
+    else if ( a == "-g" ) ciclosGrabar = atoi( argv[i + 1] );
+    else if ( a == "-s" ) semilla = (unsigned) atoi( argv[i + 1] );
+    else if ( a == "-r" ) ruidoLSB = atof( argv[i + 1] );
+    else if ( a == "-m" ) nAvg = std::max( MUESTRAS_AUTOMATICAS, atoi( argv[i + 1] ) );
+    else if ( a == "-a" ) ajustar = atoi( argv[i + 1] ) != 0;
+    else if ( a == "-p" ) precisionO3 = (float) atof( argv[i + 1] );
+  }
+  if ( ruta.empty() ) {
+    std::cerr << "uso: reproductorADC -f traza [-n repeticiones] [-e huella]\n"
+              << "     reproductorADC -f traza -g ciclos [-s semilla] [-r ruido] [-m lecturas]\n"
+              << "     reproductorADC -f traza -a 1 [-p precision]\n";
+    return 2;
+  }
+
+  try {
+    if ( ciclosGrabar > 0 ) {
+      Resultado r = grabarSintetica( ruta, ciclosGrabar, semilla, ruidoLSB, nAvg );
+      char huella[17];
+      snprintf( huella, sizeof( huella ), "%016llx", (unsigned long long) r.huella );
+      std::cout << "lecturas grabadas: " << r.lecturas << "  medidas: " << r.medidas << "\n"
+                << "huella en directo: " << huella << "\n";
+      return 0;
+    }
+
+    std::vector<Lectura> lecturas = cargarTraza( ruta );
+    if ( ajustar ) return validarAjuste( lecturas, precisionO3 );
+
+    Resultado r;
+    double mejor = 1e30;
+    for ( int k = 0; k < repeticiones; k++ ) {
+      auto t0 = std::chrono::steady_clock::now();
+      r = reproducir( lecturas );
+      mejor = std::min( mejor, std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count() );
+    }
+
+    char huella[17];
+    snprintf( huella, sizeof( huella ), "%016llx", (unsigned long long) r.huella );
+    std::cout << "lecturas: " << lecturas.size() << "  medidas: " << r.medidas
+              << "  alarmas: " << r.alarmas << "\n";
+    for ( int c = 0; c < NUM_CANALES; c++ ) {
+      if ( r.porCanal[c] > 0 ) std::cout << "  " << NOMBRES_CANALES[c] << ": " << r.porCanal[c] << "\n";
+    }
+    std::cout << "huella: " << huella << "\n"
+              << "mejor tiempo (s): " << mejor << "  lecturas/s: " << lecturas.size() / mejor << "\n";
+
+    if ( huellaEsperada != nullptr && std::string( huellaEsperada ) != huella ) {
+      std::cerr << "la huella no coincide (esperada " << huellaEsperada << ")\n";
+      return 1;
+    }
+  } catch ( const std::exception & e ) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file simuladorAlarma.cpp
+ * @brief Mide en el ordenador la latencia extremo a extremo de las alarmas.
+ * @author Rocio
+ * @date 18/10/2026
+ * @details Compila el sketch real (setup() y loop()) sobre la placa simulada
+ * y le inyecta una señal de ozono que alterna tramos limpios con tramos por
+ * encima del umbral de alarma. Para cada cruce de umbral mide el tiempo hasta
+ * que el primer anuncio con la bandera de alarma sale al aire.
+ *
+ * **Compilación** (desde src/Simulador):
+ *
+ *     g++ -std=c++17 -O2 -I. simuladorAlarma.cpp -o simuladorAlarma
+ *
+ * **Uso:** `simuladorAlarma [cruces] [semilla]`
+ */
+
+#include "../HolaMundoIBeacon/HolaMundoIBeacon.ino"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+/// @brief O3 en los tramos limpios (ppm).
+const float O3_LIMPIO_PPM = 0.050f;
+/// @brief O3 en los tramos de alarma (ppm).
+const float O3_ALARMA_PPM = 0.300f;
+/// @brief Código ADC de VREF (0.6 V con 12 bits y fondo de escala de 1.2 V).
+const int CODIGO_VREF = 2048;
+/// @brief Retardo aleatorio máximo que el estándar añade a cada anuncio (µs).
+const uint64_t RETARDO_ANUNCIO_MAX_US = 10000;
+
+/**
+ * @brief Tramo de la señal simulada.
+ */
+struct Tramo {
+  uint64_t inicioUs;
+  float ppm;
+};
+
+/**
+ * @brief Pasa una concentración de O3 al código ADC que produciría Vgas.
+ * @details Invierte la conversión de Medidor::medirPPM().
+ */
+int codigoVgas( float ppm ) {
+  float deltaV = ppm * GAIN_TIA * -SENSIBILIDAD_SENSOR * 1e-6f;
+  float fullScale = (float)( ( 1 << O3_ADC_BITS ) - 1 );
+  return CODIGO_VREF + (int)( deltaV / O3_VDD * fullScale + 0.5f );
+}
+
+/**
+ * @brief Busca la trama de sensores dentro de las estructuras AD de un anuncio.
+ * @return Puntero al primer byte de la trama o nullptr si no la hay.
+ */
+const uint8_t * buscarPayload( const std::vector<uint8_t> & ad, uint8_t & tam ) {
+  for ( size_t i = 0; i + 1 < ad.size(); i += ad[i] + 1 ) {
+    if ( ad[i] == 0 ) break;
+    if ( ad[i + 1] == BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA && ad[i] >= 4 ) {
+      tam = (uint8_t)( ad[i] - 3 );
+      return &ad[i + 4];
+    }
+  }
+  return nullptr;
+}
+
+int main( int argc, char * argv[] ) {
+  const int numCruces = ( argc > 1 ? atoi( argv[1] ) : 200 );
+  const unsigned semilla = ( argc > 2 ? (unsigned) atoi( argv[2] ) : 1 );
+
+  std::mt19937 generador( semilla );
+  simulador::PlacaSimulada & placa = *simulador::placaActual();
+  placa.generador.seed( semilla );
+
+  // --- Señal: tramos limpios de 60-180 s y tramos de alarma de 20-60 s ---
+  std::vector<Tramo> tramos;
+  std::vector<uint64_t> cruces;
+  uint64_t t = 20ULL * 1000000; // deja terminar el setup()
+  tramos.push_back( { 0, O3_LIMPIO_PPM } );
+  for ( int i = 0; i < numCruces; i++ ) {
+    t += std::uniform_int_distribution<uint64_t>( 60000000, 180000000 )( generador );
+    tramos.push_back( { t, O3_ALARMA_PPM } );
+    cruces.push_back( t );
+    t += std::uniform_int_distribution<uint64_t>( 20000000, 60000000 )( generador );
+    tramos.push_back( { t, O3_LIMPIO_PPM } );
+  }
+  const uint64_t finUs = t + 60ULL * 1000000;
+
+  placa.lectorADC = [ & ]( int pin ) -> int {
+    if ( pin == O3_PIN_VREF ) return CODIGO_VREF;
+    if ( pin == O3_PIN_VGAS ) {
+      auto it = std::upper_bound( tramos.begin(), tramos.end(), placa.tiempoUs,
+                                  []( uint64_t us, const Tramo & tr ) { return us < tr.inicioUs; } );
+      return codigoVgas( ( it - 1 )->ppm );
+    }
+    return 900; // batería (~3.9 V tras el divisor)
+  };
+
+  // --- Primer anuncio con bandera de alarma tras cada cruce ---
+  std::vector<uint64_t> anunciosAlarma;
+  placa.alEmitir = [ & ]( const simulador::Emision & e ) {
+    uint8_t tam = 0;
+    Medidas m;
+    const uint8_t * p = buscarPayload( e.datos, tam );
+    if ( p != nullptr && desempaquetarTrama( p, tam, m ) != 0 && ( m.alarmas & ALARMA_O3 ) != 0 ) {
+      uint64_t retardo = std::uniform_int_distribution<uint64_t>( 0, RETARDO_ANUNCIO_MAX_US )( generador );
+      anunciosAlarma.push_back( e.inicioUs + retardo );
+    }
+  };
+
+  // Sin alarma, un loop() dura lo que tarda en medir y anunciar un ciclo
+  // completo: es la latencia que tendría vigilar solo una vez por ciclo
+  setup();
+  uint64_t cicloMaximoUs = 0;
+  while ( placa.tiempoUs < finUs ) {
+    uint64_t inicioUs = placa.tiempoUs;
+    loop();
+    cicloMaximoUs = std::max( cicloMaximoUs, placa.tiempoUs - inicioUs );
+  }
+
+  std::vector<double> latenciasMs;
+  for ( uint64_t cruce : cruces ) {
+    auto it = std::lower_bound( anunciosAlarma.begin(), anunciosAlarma.end(), cruce );
+    if ( it != anunciosAlarma.end() ) {
+      latenciasMs.push_back( ( *it - cruce ) / 1000.0 );
+    }
+  }
+  std::sort( latenciasMs.begin(), latenciasMs.end() );
+
+  if ( latenciasMs.empty() ) {
+    std::cout << "Ninguna alarma detectada\n";
+    return 1;
+  }
+
+  double suma = 0;
+  for ( double l : latenciasMs ) suma += l;
+  auto percentil = [ & ]( double p ) { return latenciasMs[ (size_t)( p * ( latenciasMs.size() - 1 ) ) ]; };
+
+  std::cout << "Cruces de umbral:        " << cruces.size() << "\n"
+            << "Alarmas detectadas:      " << latenciasMs.size() << "\n"
+            << "Latencia minima (ms):    " << latenciasMs.front() << "\n"
+            << "Latencia media (ms):     " << suma / latenciasMs.size() << "\n"
+            << "Latencia p50 (ms):       " << percentil( 0.50 ) << "\n"
+            << "Latencia p95 (ms):       " << percentil( 0.95 ) << "\n"
+            << "Latencia maxima (ms):    " << latenciasMs.back() << "\n"
+            << "Peor caso sin alarmas (ms): " << cicloMaximoUs / 1000.0 << "\n";
+
+  return latenciasMs.size() == cruces.size() ? 0 : 1;
+}